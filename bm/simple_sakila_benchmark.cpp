@@ -1,4 +1,5 @@
 #include <benchmark/benchmark.h>
+#include <atomic>
 #include <iostream>
 #include <chrono>
 #include <thread>
@@ -13,6 +14,7 @@
 #include "my_di_extension.hpp"
 #include "mysql_base.hpp"
 #include "mysql_config_provider.hpp"
+#include "mysql_coro.hpp"
 #include "mysql_monad.hpp"
 #include "simple_data.hpp"
 #include "tutil.hpp"
@@ -148,4 +150,83 @@ BENCHMARK_F(SakilaBenchmark, JoinQuery)(benchmark::State& state) {
   }
 }
 
-BENCHMARK_MAIN();
\ No newline at end of file
+// IO style vs coroutine style
+// --------------------------------------------------------------------
+// The same work through the IO monad and through the co_await API
+// (mysql_coro.hpp). Coroutines run on a local io_context that the
+// benchmark thread drives, so each iteration includes the hop back from the
+// MySQL IO thread.
+
+static const char* const kCountFilms = "SELECT COUNT(*) FROM film";
+static const char* const kTouchFilm =
+    "UPDATE film SET rental_rate = rental_rate WHERE film_id = 1";
+
+BENCHMARK_F(SakilaBenchmark, SimpleSelectCoroutine)(benchmark::State& state) {
+  asio::io_context ioc;
+  for (auto _ : state) {
+    auto session = createSession();
+    asio::co_spawn(
+        ioc,
+        [session]() -> asio::awaitable<void> {
+          auto r = co_await co_run_query(*session, kCountFilms);
+          if (r.is_ok()) {
+            auto row = r.value().expect_one_row_borrowed(
+                "Expected film count", 0, 0);
+            benchmark::DoNotOptimize(row);
+          }
+        },
+        asio::detached);
+    ioc.run();
+    ioc.restart();
+  }
+}
+
+// START TRANSACTION, a read, a no-op write and COMMIT on one connection.
+BENCHMARK_F(SakilaBenchmark, TransactionIO)(benchmark::State& state) {
+  for (auto _ : state) {
+    std::atomic<bool> completed{false};
+    auto session = createSession();
+
+    session->begin_transaction()
+        .then([session](MysqlSessionState s) {
+          return session->run_in(std::move(s), kCountFilms);
+        })
+        .then([session](MysqlSessionState s) {
+          return session->run_in(std::move(s), kTouchFilm);
+        })
+        .then([session](MysqlSessionState s) {
+          return session->run_in(std::move(s), "COMMIT");
+        })
+        .run([&](auto r) {
+          benchmark::DoNotOptimize(r.is_ok());
+          completed = true;
+        });
+
+    while (!completed) {
+      std::this_thread::sleep_for(std::chrono::microseconds(10));
+    }
+  }
+}
+
+BENCHMARK_F(SakilaBenchmark, TransactionCoroutine)(benchmark::State& state) {
+  asio::io_context ioc;
+  for (auto _ : state) {
+    auto session = createSession();
+    asio::co_spawn(
+        ioc,
+        [session]() -> asio::awaitable<void> {
+          auto r = co_await co_transaction(
+              session, [](CoTransaction& tx) -> asio::awaitable<MyVoidResult> {
+                auto read = co_await tx.execute(kCountFilms);
+                if (read.is_err()) co_return read;
+                co_return co_await tx.execute(kTouchFilm);
+              });
+          benchmark::DoNotOptimize(r.is_ok());
+        },
+        asio::detached);
+    ioc.run();
+    ioc.restart();
+  }
+}
+
+BENCHMARK_MAIN();
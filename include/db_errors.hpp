@@ -10,6 +10,10 @@ constexpr int NO_ROWS = 1001;  // not found
 constexpr int MULTIPLE_RESULTS = 1002;  // multiple result.
 constexpr int NULL_ID = 1003;  // return object has null id.
 constexpr int INDEX_OUT_OF_BOUNDS = 1004;  // row index out of bounds.
+constexpr int QUERY_TIMEOUT = 1005;  // query exceeded its execution deadline.
+constexpr int DEADLINE_EXCEEDED = 1006;  // request deadline budget exhausted.
+constexpr int CANCELLED = 1007;  // query cancelled by the caller.
+constexpr int NO_CONNECTION = 1008;  // statement needs a state holding a connection.
 }  // namespace SQL_EXEC
 
 namespace PARSE {  // PARSE errors
@@ -17,4 +21,15 @@ namespace PARSE {  // PARSE errors
 constexpr int BAD_VALUE_ACCESS = 2000;  // bad value access.
 }  // namespace PARSE
 
+namespace POOL {  // POOL errors
+
+constexpr int OVERLOADED = 3000;  // pool concurrency limit reached.
+constexpr int CIRCUIT_OPEN = 3001;  // circuit breaker open after repeated acquisition failures.
+constexpr int LEASE_RECLAIMED = 3002;  // connection lease reclaimed by the pool.
+constexpr int DRAINING = 3003;  // pool is draining for shutdown.
+constexpr int UNKNOWN_DATABASE = 3004;  // no pool configured under that database name.
+constexpr int TENANT_RATE_LIMITED = 3005;  // tenant exceeded its query rate limit.
+constexpr int TENANT_IN_FLIGHT_LIMITED = 3006;  // tenant exceeded its in-flight query limit.
+}  // namespace POOL
+
 }  // namespace db_errors
\ No newline at end of file
@@ -0,0 +1,169 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+
+namespace sql {
+
+enum class Admission { Admitted, Overloaded, CircuitOpen };
+
+struct AdmissionOptions {
+  // Concurrency limit bounds (requests waiting for or holding a connection).
+  // The limit starts at max_limit and adapts in between.
+  double min_limit{1};
+  double max_limit{64};
+  // Latency growth over the long-term baseline tolerated before the limit
+  // shrinks (2.0 = twice the usual acquire+execute latency).
+  double tolerance{2.0};
+  // Weight of each new limit estimate.
+  double smoothing{0.2};
+  // Consecutive acquisition failures (timeouts, connect errors) that open the
+  // circuit; 0 disables the breaker.
+  uint32_t breaker_threshold{5};
+  std::chrono::milliseconds breaker_open{1000};
+};
+
+// AdmissionController
+// --------------------------------------------------------------------
+// Gradient concurrency limiter plus circuit breaker in front of connection
+// acquisition. Instead of letting every caller queue for the full acquire
+// timeout when the pool saturates, callers beyond the current limit are
+// rejected on the spot.
+//
+// Limit: every completed request reports its acquire+execute latency.
+//   gradient  = clamp(tolerance * long_rtt / short_rtt, 0.5, 1)
+//   new_limit = limit * gradient + sqrt(limit)
+// A steady latency keeps growing the limit (by roughly sqrt(limit)); queueing
+// shows up as short_rtt rising over the long-term baseline and shrinks it.
+// The limit only grows while at least half of it is in use, so an idle pool
+// does not drift to max_limit. Acquisition failures halve the limit.
+//
+// Breaker: `breaker_threshold` consecutive failures open the circuit for
+// `breaker_open`; afterwards a single probe is let through (half-open). A
+// successful acquisition closes the circuit, a failed probe reopens it.
+class AdmissionController {
+ public:
+  using Clock = std::chrono::steady_clock;
+
+  explicit AdmissionController(AdmissionOptions opts)
+      : opts_(opts), limit_(opts.max_limit) {}
+
+  Admission try_admit(Clock::time_point now = Clock::now()) {
+    std::lock_guard<std::mutex> lock(mu_);
+    if (breaker_ == Breaker::Open) {
+      if (now < open_until_) return Admission::CircuitOpen;
+      breaker_ = Breaker::HalfOpen;
+      probe_in_flight_ = false;
+    }
+    if (breaker_ == Breaker::HalfOpen) {
+      if (probe_in_flight_) return Admission::CircuitOpen;
+      probe_in_flight_ = true;
+      ++in_flight_;
+      return Admission::Admitted;
+    }
+    if (static_cast<double>(in_flight_) >= std::floor(limit_)) {
+      return Admission::Overloaded;
+    }
+    ++in_flight_;
+    return Admission::Admitted;
+  }
+
+  // An admitted request is done (connection returned).
+  void release() noexcept {
+    std::lock_guard<std::mutex> lock(mu_);
+    if (in_flight_ > 0) --in_flight_;
+  }
+
+  // An admitted request was abandoned by its caller before it obtained a
+  // connection. Frees the slot without counting as a failure; a cancelled
+  // half-open probe lets the next request probe instead.
+  void on_abandoned() noexcept {
+    std::lock_guard<std::mutex> lock(mu_);
+    if (in_flight_ > 0) --in_flight_;
+    if (breaker_ == Breaker::HalfOpen) probe_in_flight_ = false;
+  }
+
+  // An admitted request obtained its connection.
+  void on_acquired() {
+    std::lock_guard<std::mutex> lock(mu_);
+    consecutive_failures_ = 0;
+    if (breaker_ == Breaker::HalfOpen) {
+      breaker_ = Breaker::Closed;
+      probe_in_flight_ = false;
+    }
+  }
+
+  // An admitted request failed to obtain a connection. Frees its slot (no
+  // release() needed) and returns true when this failure opened the circuit.
+  bool on_failure(Clock::time_point now = Clock::now()) {
+    std::lock_guard<std::mutex> lock(mu_);
+    if (in_flight_ > 0) --in_flight_;
+    ++consecutive_failures_;
+    limit_ = std::max(opts_.min_limit, limit_ * 0.5);
+    bool trip = breaker_ == Breaker::HalfOpen ||
+                (breaker_ == Breaker::Closed && opts_.breaker_threshold > 0 &&
+                 consecutive_failures_ >= opts_.breaker_threshold);
+    if (!trip) return false;
+    breaker_ = Breaker::Open;
+    probe_in_flight_ = false;
+    open_until_ = now + opts_.breaker_open;
+    return true;
+  }
+
+  // acquire+execute latency of a successful request.
+  void record(Clock::duration latency) {
+    double rtt = std::max(
+        1.0, static_cast<double>(
+                 std::chrono::duration_cast<std::chrono::microseconds>(latency)
+                     .count()));
+    std::lock_guard<std::mutex> lock(mu_);
+    if (long_rtt_ == 0) long_rtt_ = short_rtt_ = rtt;
+    short_rtt_ += (rtt - short_rtt_) * 0.5;
+    long_rtt_ += (rtt - long_rtt_) / kLongWindow;
+    // Let the baseline follow a lasting latency improvement quickly.
+    if (long_rtt_ > short_rtt_ * 2) long_rtt_ *= 0.95;
+    double gradient =
+        std::clamp(opts_.tolerance * long_rtt_ / short_rtt_, 0.5, 1.0);
+    double target = limit_ * gradient + std::sqrt(limit_);
+    if (target > limit_ && static_cast<double>(in_flight_) < limit_ / 2) {
+      target = limit_;
+    }
+    limit_ = std::clamp(
+        limit_ * (1 - opts_.smoothing) + target * opts_.smoothing,
+        opts_.min_limit, opts_.max_limit);
+  }
+
+  std::size_t limit() const {
+    std::lock_guard<std::mutex> lock(mu_);
+    return static_cast<std::size_t>(limit_);
+  }
+  std::size_t in_flight() const {
+    std::lock_guard<std::mutex> lock(mu_);
+    return in_flight_;
+  }
+  bool circuit_open() const {
+    std::lock_guard<std::mutex> lock(mu_);
+    return breaker_ != Breaker::Closed;
+  }
+
+ private:
+  enum class Breaker { Closed, Open, HalfOpen };
+  static constexpr double kLongWindow = 100;
+
+  mutable std::mutex mu_;
+  AdmissionOptions opts_;
+  double limit_;
+  double short_rtt_{0};
+  double long_rtt_{0};
+  std::size_t in_flight_{0};
+  uint32_t consecutive_failures_{0};
+  Breaker breaker_{Breaker::Closed};
+  bool probe_in_flight_{false};
+  Clock::time_point open_until_{};
+};
+
+}  // namespace sql
@@ -17,15 +17,38 @@
 #include <boost/mysql/resultset_view.hpp>
 #include <boost/shared_ptr.hpp>
 #include <boost/url.hpp>  // IWYU pragma: keep
+#include <algorithm>
 #include <cstdint>
+#include <format>
+#include <functional>
+#include <iterator>
+#include <memory>
+#include <mutex>
 #include <numbers>
+#include <optional>
+#include <random>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
 
 #include "openssl_thread_cleanup.hpp"
 
 #include "base64.h"
 #include "common_macros.hpp"
 #include "db_errors.hpp"
+#include "io_monad.hpp"
+#include "mysql_admission.hpp"
 #include "mysql_config_provider.hpp"
+#include "mysql_io_lag.hpp"
+#include "mysql_lease.hpp"
+#include "mysql_metrics.hpp"
+#include "mysql_pool_registry.hpp"
+#include "mysql_pool_sizer.hpp"
+#include "mysql_priority_gate.hpp"
+#include "mysql_shard.hpp"
+#include "mysql_ssl_cache.hpp"
+#include "mysql_tenant.hpp"
 #include "result_monad.hpp"
 #include "mysql_io_context.hpp"
 
@@ -43,15 +66,86 @@ inline uint64_t epoch_milliseconds(boost::mysql::field_view f) {
       .count();
 }
 
+// `base` randomly stretched or shrunk by up to `spread` (0.25 = +/-25%), so
+// periodic work of many pools/processes does not line up.
+inline std::chrono::milliseconds jittered(std::chrono::milliseconds base,
+                                          double spread) {
+  thread_local std::mt19937_64 rng{std::random_device{}()};
+  std::uniform_real_distribution<double> dist(1.0 - spread, 1.0 + spread);
+  return std::chrono::milliseconds(static_cast<int64_t>(
+      static_cast<double>(base.count()) * dist(rng)));
+}
+
+// Whether connection_pool::async_get_connection failed because the pool
+// could not connect (it reports the last connect or handshake error it
+// saw), as opposed to finding no free connection in time, being cancelled
+// or being stopped. Only the former feeds connection pacing.
+inline bool is_connect_error(const boost::system::error_code& ec) {
+  return ec && ec != mysql::client_errc::no_connection_available &&
+         ec != mysql::client_errc::pool_not_running &&
+         ec != asio::error::operation_aborted;
+}
+
+// Statement run on every connection before it is handed out. Pins
+// session-level time computations (NOW(), CURRENT_TIMESTAMP, date casts,
+// etc.) to UTC instead of the server/session timezone.
+inline constexpr std::string_view kSessionSetupSql = "SET time_zone = '+00:00'";
+
+struct MysqlPoolWrapper;
+// Defined after MysqlPoolWrapper; returns the acquisition permit and
+// admission slot held by a TrackedPooledConn and closes its lease (0 when
+// untracked). `returned`/`reset` describe how its connection went back to
+// the pool (for metrics).
+void release_pool_permit(MysqlPoolWrapper* pool, bool returned, bool reset,
+                         uint64_t lease_id) noexcept;
+
 struct MysqlSessionState {
   struct TrackedPooledConn {
     mysql::pooled_connection inner;
+    // Pool whose acquisition permit this connection holds (nullptr when the
+    // connection did not come through MysqlPoolWrapper's gate).
+    MysqlPoolWrapper* permit_owner{nullptr};
+    // When the request passed admission control; start of the
+    // acquire+execute latency the first statement on this connection feeds
+    // back to the limiter. Cleared afterwards, so later statements of a
+    // transaction report their own execution time.
+    std::chrono::steady_clock::time_point admitted_at{};
+    // Whether the session may carry state (SET, temporary tables, user
+    // variables, an open transaction, ...) that the next borrower must not
+    // see. Clean connections skip the pool's reset round trip on return.
+    // Anything handing the raw connection to user code must set this.
+    bool needs_reset{true};
+    // Lease bookkeeping of permit_owner (null unless lease tracking is
+    // enabled). A forced reclaim takes `inner` and the permit away under
+    // lease->mu, so both only change under that lock while a lease exists.
+    std::shared_ptr<Lease<TrackedPooledConn>> lease;
     TrackedPooledConn() = default;
     TrackedPooledConn(mysql::pooled_connection&& pc) : inner(std::move(pc)) {}
+    TrackedPooledConn(mysql::pooled_connection&& pc, MysqlPoolWrapper* owner,
+                      std::shared_ptr<Lease<TrackedPooledConn>> l = nullptr)
+        : inner(std::move(pc)), permit_owner(owner), lease(std::move(l)) {
+      if (lease) lease->holder = this;
+    }
     TrackedPooledConn(TrackedPooledConn&& o) noexcept
-        : inner(std::move(o.inner)) {}
-    TrackedPooledConn& operator=(TrackedPooledConn&& o) noexcept {
+        : admitted_at(o.admitted_at),
+          needs_reset(o.needs_reset),
+          lease(std::move(o.lease)) {
+      auto guard = lock_lease();
       inner = std::move(o.inner);
+      permit_owner = std::exchange(o.permit_owner, nullptr);
+      if (lease) lease->holder = this;
+    }
+    TrackedPooledConn& operator=(TrackedPooledConn&& o) noexcept {
+      if (this != &o) {
+        release();  // our previous connection and permit
+        admitted_at = o.admitted_at;
+        needs_reset = o.needs_reset;
+        lease = std::move(o.lease);
+        auto guard = lock_lease();
+        inner = std::move(o.inner);
+        permit_owner = std::exchange(o.permit_owner, nullptr);
+        if (lease) lease->holder = this;
+      }
       return *this;
     }
     TrackedPooledConn(const TrackedPooledConn&) = delete;
@@ -64,6 +158,50 @@ struct MysqlSessionState {
             << std::endl;
       }
 #endif
+      release();
+    }
+    // Returns the connection (with or without reset, see needs_reset), then
+    // the permit, so the next waiter finds the connection idle in the pool.
+    void release() noexcept {
+      uint64_t lease_id = 0;
+      if (auto l = std::move(lease)) {
+        // From here on a reclaim can no longer reach us; if one already
+        // did, `inner` and the permit are gone.
+        std::lock_guard<std::mutex> lock(l->mu);
+        l->holder = nullptr;
+        lease_id = l->id;
+      }
+      bool returned = inner.valid();
+      bool reset = needs_reset;
+      if (returned) {
+        if (reset) {
+          inner = mysql::pooled_connection();
+        } else {
+          inner.return_without_reset();
+        }
+      }
+      needs_reset = true;
+      if (auto* owner = std::exchange(permit_owner, nullptr)) {
+        release_pool_permit(owner, returned, reset, lease_id);
+      }
+    }
+    // Brackets an operation on the connection so a forced reclaim leaves it
+    // alone. begin_use() is false once the connection was reclaimed.
+    bool begin_use() {
+      if (!lease) return true;
+      std::lock_guard<std::mutex> lock(lease->mu);
+      if (lease->reclaimed) return false;
+      lease->busy = true;
+      return true;
+    }
+    void end_use() {
+      if (!lease) return;
+      std::lock_guard<std::mutex> lock(lease->mu);
+      lease->busy = false;
+    }
+    std::unique_lock<std::mutex> lock_lease() {
+      return lease ? std::unique_lock<std::mutex>(lease->mu)
+                   : std::unique_lock<std::mutex>();
     }
     bool valid() const { return inner.valid(); }
     mysql::pooled_connection& get() { return inner; }
@@ -451,7 +589,42 @@ struct MysqlSessionState {
   }
 };
 
-inline mysql::pool_params params(const MysqlConfig& config) {
+// Cached TLS context for `config`'s server and credentials (see
+// SslContextCache); nullptr when its connections do not use TLS.
+inline std::shared_ptr<SslContextCache::Entry> ssl_context_entry(
+    const MysqlConfig& config) {
+  if (!config.unix_socket.empty() || config.ssl <= 0) return nullptr;
+  // Parsed once per server + credentials and shared by every pool
+  // (replicas, partitions, reloads) alive at the same time.
+  auto fingerprint = config.host + ":" + std::to_string(config.port) + "\n" +
+                     config.ca_str + "\n" + config.cert_str + "\n" +
+                     config.cert_key_str;
+  return SslContextCache::instance().get(fingerprint, [&config] {
+    ssl::context client_ssl_ctx{ssl::context::tlsv12};
+    client_ssl_ctx.set_default_verify_paths();
+    client_ssl_ctx.set_verify_mode(boost::asio::ssl::verify_peer);
+    std::string ca_str = base64_decode(config.ca_str);
+    std::string cert_str = base64_decode(config.cert_str);
+    std::string cert_key_str = base64_decode(config.cert_key_str);
+
+    client_ssl_ctx.add_certificate_authority(
+        asio::const_buffer{ca_str.data(), ca_str.size()});
+    client_ssl_ctx.use_certificate_chain(
+        asio::const_buffer{cert_str.data(), cert_str.size()});
+    client_ssl_ctx.use_private_key(
+        asio::const_buffer{
+            cert_key_str.data(),
+            cert_key_str.size(),
+        },
+        ssl::context::file_format::pem);
+    return client_ssl_ctx;
+  });
+}
+
+// `tls` is ssl_context_entry(config); the caller keeps it for as long as
+// the pool built from these params exists.
+inline mysql::pool_params params(const MysqlConfig& config,
+                                 SslContextCache::Entry* tls) {
   mysql::pool_params params;
   /// var/run/mysqld/mysqld.sock
   // SHOW VARIABLES LIKE 'socket';
@@ -462,24 +635,7 @@ inline mysql::pool_params params(const MysqlConfig& config) {
                        ? mysql::ssl_mode::disable
                        : (config.ssl == 1 ? mysql::ssl_mode::enable
                                           : mysql::ssl_mode::require);
-      ssl::context client_ssl_ctx{ssl::context::tlsv12};
-      client_ssl_ctx.set_default_verify_paths();
-      client_ssl_ctx.set_verify_mode(boost::asio::ssl::verify_peer);
-      std::string ca_str = base64_decode(config.ca_str);
-      std::string cert_str = base64_decode(config.cert_str);
-      std::string cert_key_str = base64_decode(config.cert_key_str);
-
-      client_ssl_ctx.add_certificate_authority(
-          asio::const_buffer{ca_str.data(), ca_str.size()});
-      client_ssl_ctx.use_certificate_chain(
-          asio::const_buffer{cert_str.data(), cert_str.size()});
-      client_ssl_ctx.use_private_key(
-          asio::const_buffer{
-              cert_key_str.data(),
-              cert_key_str.size(),
-          },
-          ssl::context::file_format::pem);
-      params.ssl_ctx = std::move(client_ssl_ctx);
+      params.ssl_ctx = tls->share();
     } else {
       params.ssl = mysql::ssl_mode::disable;
     }
@@ -499,6 +655,11 @@ inline mysql::pool_params params(const MysqlConfig& config) {
   // Set to 0 to avoid possible race during eager opening while diagnosing stall
   params.initial_size = config.initial_size;  // open on-demand
   params.max_size = config.max_size;          // allow up to 16
+  // Connections idle this long are pinged by the pool and reconnected if the
+  // ping fails (0 disables). Jittered per pool so the pings of many
+  // processes started together do not hit the server in lockstep.
+  params.ping_interval =
+      jittered(std::chrono::seconds(config.ping_interval), 0.25);
   // Instrument pool params
   std::cerr << "[instrument][pool_params] host="
             << (config.unix_socket.empty() ? config.host.c_str()
@@ -511,10 +672,64 @@ inline mysql::pool_params params(const MysqlConfig& config) {
   return params;
 }
 
+// Snapshot reported while MysqlPoolWrapper::drain() runs. Counts cover the
+// pool and its replica, partition, shard and database pools.
+struct DrainProgress {
+  // Requests holding or queued for a connection.
+  std::size_t in_flight{0};
+  // Statements currently executing.
+  std::size_t running{0};
+  std::chrono::milliseconds elapsed{0};
+  // The deadline passed and stragglers were killed.
+  bool killing{false};
+};
+
+struct DrainReport {
+  // Everything finished before the deadline.
+  bool clean{false};
+  std::size_t killed{0};
+  // Requests still holding a connection when the pool was stopped.
+  std::size_t abandoned{0};
+  std::chrono::milliseconds elapsed{0};
+};
+
 struct MysqlPoolWrapper {
   MysqlPoolWrapper(cjj365::MysqlIoContextManager& ioc_manager,
                    IMysqlConfigProvider& mysql_config_provider)
-      : pool_(ioc_manager.ioc(), params(mysql_config_provider.get())) {
+      : MysqlPoolWrapper(ioc_manager.ioc(), mysql_config_provider.get()) {
+    config_provider_ = &mysql_config_provider;
+    // One probe per io_context: only the root pool runs it, child pools and
+    // reload generations share the thread.
+    if (config_.io_lag_probe_ms > 0) {
+      lag_tracker_.emplace(std::chrono::milliseconds(config_.io_lag_warn_ms));
+      schedule_lag_probe();
+    }
+    reload_subscription_ = mysql_config_provider.subscribe(
+        [this, alive = std::weak_ptr<void>(lifetime_)](
+            const MysqlConfig& next) {
+          if (alive.expired()) return;
+          asio::post(ioc_, [this, alive, next] {
+            if (alive.expired()) return;
+            reload(next).run([](auto) {});
+          });
+        });
+  }
+
+ private:
+  // Child pools (replicas) share the parent's io_context. Kept private so
+  // the DI container only ever sees the public constructor above. A reload
+  // generation may take over the previous pool's tenant limiter.
+  MysqlPoolWrapper(asio::io_context& ioc, const MysqlConfig& config,
+                   std::shared_ptr<TenantLimiter> tenants = nullptr)
+      : config_(config),
+        ioc_(ioc),
+        tls_(ssl_context_entry(config_)),
+        pool_(ioc, params(config_, tls_.get())),
+        shard_map_(ShardMap::from_config(config_)),
+        shard_pools_(shard_map_.size()),
+        tenants_(tenants ? std::move(tenants)
+                         : std::make_shared<TenantLimiter>(
+                               config_.tenant_limits)) {
     active_conns_.store(0);
     // Attach an error-reporting completion handler instead of asio::detached so
     // we don't silently swallow errors.
@@ -540,9 +755,32 @@ struct MysqlPoolWrapper {
     };
     (*hb_fn)(1);
 #endif
+    for (const auto& replica_config : config_.replicas) {
+      replicas_.emplace_back(new MysqlPoolWrapper(ioc, replica_config));
+    }
+    for (const auto& partition_config : config_.partitions) {
+      partitions_.emplace_back(new MysqlPoolWrapper(ioc, partition_config));
+    }
+    metrics_.concurrency_limit.store(config_.max_size,
+                                     std::memory_order_relaxed);
+    if (config_.elastic_target_wait_ms > 0) start_concurrency_throttle();
+    if (config_.lease_warn_ms > 0) schedule_lease_sweep();
+    if (config_.connect_rate_per_sec > 0) {
+      ConnectPacerOptions pacing;
+      pacing.rate_per_sec = static_cast<double>(config_.connect_rate_per_sec);
+      pacing.burst = static_cast<double>(std::max<uint64_t>(
+          config_.connect_burst, 1));
+      pacing.backoff_base =
+          std::chrono::milliseconds(config_.connect_backoff_base_ms);
+      pacing.backoff_max =
+          std::chrono::milliseconds(config_.connect_backoff_max_ms);
+      gate_.enable_pacing(pacing);
+    }
     DEBUG_PRINT("[MysqlPoolWrapper] Constructor called.");
   }
 
+ public:
+
   // Non-copyable / non-movable to avoid multiple owners referencing the same
   // pool lifecycle implicitly.
   MysqlPoolWrapper(const MysqlPoolWrapper&) = delete;
@@ -551,20 +789,577 @@ struct MysqlPoolWrapper {
   MysqlPoolWrapper& operator=(MysqlPoolWrapper&&) = delete;
 
   ~MysqlPoolWrapper() {
+    lifetime_.reset();
+    if (config_provider_) config_provider_->unsubscribe(reload_subscription_);
     stop();
     cjj365::OpenSslThreadCleanup cleanup_guard;
     DEBUG_PRINT("[MysqlPoolWrapper] Destructor called.");
   }
 
+  // Shuts the wrapper down: its pools (see stop_pools()), every pool built
+  // by reload() and the IO lag probe.
   void stop() noexcept {
+    stop_pools();
+    if (shut_down_.exchange(true)) return;
+    lag_timer_.cancel();
+    std::lock_guard<std::mutex> lock(generations_mutex_);
+    prune_timer_.cancel();
+    for (auto& generation : generations_) generation->stop();
+  }
+
+  // Closes this pool and its child pools and stops their lease sweep and
+  // throttle timers. On its own it retires a pool replaced by
+  // reload(); what serves the wrapper as a whole (IO lag probe, reload
+  // subscription, newer generations) keeps running.
+  void stop_pools() noexcept {
     if (!stopped_) {
       stopped_ = true;
+      resize_timer_.cancel();
+      lease_timer_.cancel();
+      {
+        std::lock_guard<std::mutex> lock(pace_mutex_);
+        pace_timer_.cancel();
+      }
+      for (auto& replica : replicas_) replica->stop();
+      for (auto& partition : partitions_) partition->stop();
+      {
+        std::lock_guard<std::mutex> lock(shard_create_mutex_);
+        for (auto& shard : shard_owned_) shard->stop();
+      }
+      databases_.for_each([](MysqlPoolWrapper& db) { db.stop(); });
       pool_.cancel();  // cancel timers / outstanding waits; connections return
                        // as they finish.
       DEBUG_PRINT("[MysqlPoolWrapper] stop() invoked.");
     }
   }
 
+  bool stopped() const { return stopped_.load(); }
+
+  const MysqlConfig& config() const { return config_; }
+
+  // Graceful shutdown for rolling restarts, instead of stop() dropping
+  // in-flight queries mid-execution:
+  //  1. new acquisitions are rejected (db_errors::POOL::DRAINING); requests
+  //     already queued at the gate still get their connection;
+  //  2. in-flight work may finish until `deadline`;
+  //  3. statements still running then get KILL QUERY plus a terminal
+  //     cancellation, and up to kDrainKillGrace to unwind;
+  //  4. stop() closes the pools (idle connections end with COM_QUIT) and
+  //     shuts the wrapper down.
+  // `on_progress` runs on the pool executor at every poll. Covers child
+  // pools (replicas, partitions, shards, databases) and pools built by
+  // reload(). The pool must outlive the IO; call it before stopping the
+  // io_context.
+  using DrainListener = std::function<void(const DrainProgress&)>;
+  static constexpr auto kDrainPoll = std::chrono::milliseconds(100);
+  static constexpr auto kDrainKillGrace = std::chrono::seconds(1);
+  monad::IO<DrainReport> drain(std::chrono::steady_clock::duration deadline,
+                               DrainListener on_progress = {}) {
+    std::vector<MysqlPoolWrapper*> trees{this};
+    std::vector<std::shared_ptr<MysqlPoolWrapper>> pins;
+    {
+      std::lock_guard<std::mutex> lock(generations_mutex_);
+      pins = generations_;
+    }
+    for (auto& generation : pins) trees.push_back(generation.get());
+    return drain_trees(std::move(trees), deadline, std::move(on_progress))
+        .then([this, pins](DrainReport report) {
+          stop();
+          return monad::IO<DrainReport>::pure(std::move(report));
+        });
+  }
+
+  bool draining() const { return draining_.load(std::memory_order_acquire); }
+
+  // The pool new work should use: this one, or the latest pool built by
+  // reload(). Sessions resolve it per query.
+  MysqlPoolWrapper& current() {
+    auto* p = current_.load(std::memory_order_acquire);
+    return p ? *p : *this;
+  }
+
+  // current(), held: a pool built by reload() is not destroyed while a pin
+  // on it exists (see prune_generations()). IOs that keep pointers into the
+  // current pool hold a pin until they complete. A pin on this wrapper
+  // itself does not own it; it must outlive its sessions as before.
+  std::shared_ptr<MysqlPoolWrapper> pin_current() {
+    std::lock_guard<std::mutex> lock(generations_mutex_);
+    auto* live = current_.load(std::memory_order_acquire);
+    for (auto& generation : generations_) {
+      if (generation.get() == live) return generation;
+    }
+    return std::shared_ptr<MysqlPoolWrapper>(std::shared_ptr<void>(), this);
+  }
+
+  // Pools built by reload() and not pruned yet, the current one included.
+  std::size_t generation_count() {
+    std::lock_guard<std::mutex> lock(generations_mutex_);
+    return generations_.size();
+  }
+
+  // Hot reload (triggered by IMysqlConfigProvider::reload()): when `next`
+  // differs from the active pool's config, a pool is built from it and
+  // warmed up to initial_size within its acquire timeout. Once at least one
+  // connection is ready, current() switches to it atomically and the
+  // previous pool drains (drain_timeout_ms) in the background. A config
+  // that cannot connect is rejected and the current pool stays. Completes
+  // with whether the switch happened. A reload arriving while another one
+  // runs is applied after it (only the newest is kept).
+  // Only the replaced pool is retired (stop_pools()); the IO lag probe and
+  // the reload subscription stay with this wrapper, and each generation
+  // runs its own lease sweep and concurrency throttle. Retired
+  // generations are destroyed once idle (see prune_generations()).
+  // A reload that keeps tenant_limits keeps the tenant limiter, with its
+  // buckets, in-flight counts and metrics; one that changes them starts
+  // every tenant afresh.
+  monad::IO<bool> reload(MysqlConfig next) {
+    using ReloadIO = monad::IO<bool>;
+    return ReloadIO([this, next = std::move(next)](auto cb) mutable {
+      {
+        std::lock_guard<std::mutex> lock(generations_mutex_);
+        if (shut_down_) {
+          cb(ReloadIO::IOResult::Ok(false));
+          return;
+        }
+        if (reloading_) {
+          pending_reload_ = std::move(next);
+          cb(ReloadIO::IOResult::Ok(false));
+          return;
+        }
+        reloading_ = true;
+      }
+      auto old = pin_current();
+      if (next == old->config()) {
+        finish_reload();
+        cb(ReloadIO::IOResult::Ok(false));
+        return;
+      }
+      auto tenants = next.tenant_limits == old->config().tenant_limits
+                         ? old->tenants_
+                         : nullptr;
+      std::shared_ptr<MysqlPoolWrapper> fresh(
+          new MysqlPoolWrapper(ioc_, next, std::move(tenants)));
+      {
+        std::lock_guard<std::mutex> lock(generations_mutex_);
+        generations_.push_back(fresh);
+      }
+      auto target = std::min(next.initial_size, next.max_size);
+      fresh->warm_up(target, fresh->acquire_timeout())
+          .run([this, alive = std::weak_ptr<void>(lifetime_), fresh, old,
+                target, cb = std::move(cb)](auto r) mutable {
+            if (alive.expired()) {
+              cb(ReloadIO::IOResult::Ok(false));
+              return;
+            }
+            std::size_t warmed = r.is_ok() ? r.value() : 0;
+            if (target > 0 && warmed == 0) {
+              BOOST_LOG_SEV(lg_, boost::log::trivial::error)
+                  << "[MysqlPoolWrapper] reloaded config could not connect "
+                     "to "
+                  << fresh->config_.host << ":" << fresh->config_.port
+                  << "; keeping the current pool";
+              fresh->stop();
+              fresh.reset();
+              prune_generations();
+              finish_reload();
+              cb(ReloadIO::IOResult::Ok(false));
+              return;
+            }
+            current_.store(fresh.get(), std::memory_order_release);
+            BOOST_LOG_SEV(lg_, boost::log::trivial::info)
+                << "[MysqlPoolWrapper] switched to reloaded pool "
+                << fresh->config_.host << ":" << fresh->config_.port
+                << " max_size=" << fresh->config_.max_size
+                << " warmed=" << warmed;
+            auto drain_timeout =
+                std::chrono::milliseconds(old->config_.drain_timeout_ms);
+            drain_trees({old.get()}, drain_timeout, {})
+                .run([this, alive, old](auto report) mutable {
+                  old.reset();
+                  if (alive.expired()) return;
+                  prune_generations();
+                  if (report.is_err()) return;
+                  BOOST_LOG_SEV(lg_, boost::log::trivial::info)
+                      << "[MysqlPoolWrapper] replaced pool drained clean="
+                      << report.value().clean
+                      << " killed=" << report.value().killed
+                      << " abandoned=" << report.value().abandoned;
+                });
+            finish_reload();
+            cb(ReloadIO::IOResult::Ok(true));
+          });
+    });
+  }
+
+  // Statements currently executing on connections of this pool, so drain()
+  // can kill stragglers. track_statement() returns the id to untrack.
+  uint64_t track_statement(std::optional<uint32_t> connection_id,
+                           std::shared_ptr<asio::cancellation_signal> cancel) {
+    std::lock_guard<std::mutex> lock(running_mutex_);
+    auto id = ++running_seq_;
+    running_.emplace(id, RunningStatement{connection_id, std::move(cancel)});
+    return id;
+  }
+  void untrack_statement(uint64_t id) noexcept {
+    std::lock_guard<std::mutex> lock(running_mutex_);
+    running_.erase(id);
+  }
+
+  // Number of statements executing right now on this pool and its child
+  // pools (replicas, partitions, shards, databases). Pools retired by
+  // reload() are not included.
+  std::size_t running_statements() {
+    std::size_t n = 0;
+    for_each_pool([&n](MysqlPoolWrapper& p) {
+      std::lock_guard<std::mutex> lock(p.running_mutex_);
+      n += p.running_.size();
+    });
+    return n;
+  }
+
+  // Runs KILL QUERY for `connection_id` on another connection of this pool
+  // (fire and forget). The connection is taken through the priority gate at
+  // Interactive priority, so a kill that makes the pool open a connection
+  // is paced like any other. The kill gives up after kKillQueryTimeout so a
+  // saturated pool cannot hold it, and the statement it targets, forever.
+  // The pool must outlive the kill (see prune_generations()).
+  static constexpr auto kKillQueryTimeout = std::chrono::seconds(2);
+  void kill_query(uint32_t connection_id) {
+    metrics_.queries_killed.fetch_add(1, std::memory_order_relaxed);
+    auto cancel = std::make_shared<asio::cancellation_signal>();
+    auto expired = std::make_shared<std::atomic<bool>>(false);
+    auto timer = std::make_shared<asio::steady_timer>(pool_.get_executor());
+    timer->expires_after(kKillQueryTimeout);
+    timer->async_wait(
+        [cancel, expired](const boost::system::error_code& ec) {
+          if (ec) return;
+          expired->store(true);
+          cancel->emit(asio::cancellation_type::terminal);
+        });
+    // On the pool executor, like the timer, so emit() never races the
+    // binding of the slot.
+    auto start = [this, connection_id, cancel, expired, timer] {
+      if (expired->load()) {
+        release_permit();
+        return;
+      }
+      pool_.async_get_connection(asio::bind_cancellation_slot(
+          cancel->slot(),
+          [this, connection_id, cancel, timer](
+              boost::system::error_code ec, mysql::pooled_connection conn) {
+            if (ec) {
+              timer->cancel();
+              if (is_connect_error(ec)) on_connect_failure();
+              release_permit();
+              return;
+            }
+            auto holder =
+                std::make_shared<mysql::pooled_connection>(std::move(conn));
+            auto results = std::make_shared<mysql::results>();
+            auto diag = std::make_shared<mysql::diagnostics>();
+            (*holder)->async_execute(
+                std::format("KILL QUERY {}", connection_id), *results, *diag,
+                asio::bind_cancellation_slot(
+                    cancel->slot(), [this, holder, results, diag, cancel,
+                                     timer](mysql::error_code kill_ec) {
+                      timer->cancel();
+                      if (!kill_ec) {
+                        holder->return_without_reset();
+                      } else {
+                        auto dropped = std::move(*holder);  // with reset
+                      }
+                      release_permit();
+                    }));
+          }));
+    };
+    acquire_permit(Priority::Interactive, [this, start]() mutable {
+      asio::dispatch(pool_.get_executor(), std::move(start));
+    });
+  }
+
+  std::chrono::milliseconds acquire_timeout() const {
+    return std::chrono::milliseconds(config_.acquire_timeout_ms);
+  }
+
+  // Pool for a workload class. Unknown or empty names (e.g. "interactive"
+  // when it is not configured separately) map to this pool. The partition
+  // list is fixed at construction, so the lookup takes no lock.
+  MysqlPoolWrapper& partition(std::string_view workload) {
+    if (workload.empty()) return *this;
+    for (auto& p : partitions_) {
+      if (p->config_.name == workload) return *p;
+    }
+    return *this;
+  }
+
+  // Read replicas configured under "replicas". Empty when reads must go to
+  // this (primary) pool.
+  bool has_replicas() const { return !replicas_.empty(); }
+  // Round-robin choice of a replica pool. Requires has_replicas().
+  MysqlPoolWrapper& pick_replica() {
+    auto i = replica_rr_.fetch_add(1, std::memory_order_relaxed);
+    return *replicas_[i % replicas_.size()];
+  }
+  std::size_t replica_count() const { return replicas_.size(); }
+  // Next replica in round-robin order that is not `avoid` (used for hedging).
+  MysqlPoolWrapper& pick_replica_except(const MysqlPoolWrapper* avoid) {
+    for (std::size_t n = 0; n < replicas_.size(); ++n) {
+      auto& candidate = pick_replica();
+      if (&candidate != avoid) return candidate;
+    }
+    return pick_replica();
+  }
+
+  PoolMetrics& metrics() { return metrics_; }
+  const PoolMetrics& metrics() const { return metrics_; }
+
+  // Hedge budget: allows one more hedge only while hedges stay within
+  // hedge_budget_percent of the replica reads seen so far.
+  bool try_consume_hedge_budget() {
+    auto reads = metrics_.replica_reads.load(std::memory_order_relaxed);
+    auto sent = metrics_.hedges_sent.load(std::memory_order_relaxed);
+    if (!hedge_within_budget(reads, sent, config_.hedge_budget_percent)) {
+      return false;
+    }
+    metrics_.hedges_sent.fetch_add(1, std::memory_order_relaxed);
+    return true;
+  }
+
+  // Shards configured under "shards". Routing (shard_map().route) is pure;
+  // pools are created on first use of each shard. After creation the lookup
+  // is a single acquire load, so the hot path takes no lock.
+  const ShardMap& shard_map() const { return shard_map_; }
+  MysqlPoolWrapper& shard_pool(std::size_t index) {
+    auto* p = shard_pools_[index].load(std::memory_order_acquire);
+    if (p) return *p;
+    std::lock_guard<std::mutex> lock(shard_create_mutex_);
+    p = shard_pools_[index].load(std::memory_order_relaxed);
+    if (!p) {
+      shard_owned_.emplace_back(
+          new MysqlPoolWrapper(ioc_, shard_map_.shards[index]));
+      p = shard_owned_.back().get();
+      if (stopped_) p->stop();
+      shard_pools_[index].store(p, std::memory_order_release);
+      DEBUG_PRINT("[MysqlPoolWrapper] created shard pool " << index);
+    }
+    return *p;
+  }
+
+  // Pools of the "databases" entries, created on first use on this pool's
+  // io_context, so every named database shares one IO thread (and SSL
+  // contexts via SslContextCache). nullptr for a name that is not
+  // configured.
+  MysqlPoolWrapper* database(std::string_view name) {
+    return databases_.find(name, [this](const MysqlConfig& config) {
+      std::unique_ptr<MysqlPoolWrapper> p(new MysqlPoolWrapper(ioc_, config));
+      if (stopped_) p->stop();
+      DEBUG_PRINT("[MysqlPoolWrapper] created database pool " << config.name);
+      return p;
+    });
+  }
+  const PoolRegistry<MysqlConfig, MysqlPoolWrapper>& databases() const {
+    return databases_;
+  }
+
+  // Lag monitor of the IO thread (io_lag_probe_ms); nullptr when disabled
+  // and on child pools.
+  IoLagTracker* lag_tracker() {
+    return lag_tracker_ ? &*lag_tracker_ : nullptr;
+  }
+
+  // Per-tenant limits and metrics ("tenant_limits"); enforced by
+  // MonadicMysqlSession for queries carrying QueryOptions::tenant.
+  TenantLimiter& tenants() { return *tenants_; }
+  const TenantLimiter& tenants() const { return *tenants_; }
+
+  // Priority-aware acquisition (see PriorityGate). `start` runs as soon as
+  // the caller holds a permit: inline when one is free, otherwise posted to
+  // the pool executor when release_permit() hands one over.
+  void acquire_permit(Priority priority, std::function<void()> start) {
+    if (gate_.acquire(priority, std::move(start))) {
+      start();
+      return;
+    }
+    arm_pacing();
+  }
+  void release_permit() noexcept {
+    if (auto next = gate_.release()) {
+      asio::post(pool_.get_executor(), std::move(next));
+      return;
+    }
+    arm_pacing();
+  }
+
+  // Outcome of an acquisition that held a permit; drives connection pacing
+  // (see PriorityGate / ConnectPacer).
+  void on_connect_failure() {
+    gate_.on_connect_failure();
+    arm_pacing();
+  }
+  void on_connect_success() { gate_.on_connect_success(); }
+  const PriorityGate& gate() const { return gate_; }
+
+  AdmissionController& admission() { return admission_; }
+
+  // Eagerly opens up to `n` connections (clamped to the gate's capacity)
+  // in parallel and runs the session setup on each, so the first requests
+  // after startup do not pay connect + TLS + auth. Each attempt holds a
+  // Background permit of the priority gate, so connection pacing applies
+  // and traffic arriving meanwhile goes first. Completes with the number of
+  // connections warmed once `n` are ready or `deadline` passes, whichever
+  // comes first; it never fails, callers gate readiness on the count.
+  // Warmed connections go back to the pool without a reset so the setup
+  // stays applied. The pool must outlive the returned IO and the attempts
+  // it leaves behind.
+  monad::IO<std::size_t> warm_up(std::size_t n,
+                                 std::chrono::steady_clock::duration deadline) {
+    using WarmIO = monad::IO<std::size_t>;
+    n = std::min<std::size_t>(
+        {n, static_cast<std::size_t>(config_.max_size), gate_.capacity()});
+    return WarmIO([this, n, deadline](auto cb) {
+      struct WarmUp {
+        std::function<void(WarmIO::IOResult)> cb;
+        std::mutex mu;
+        bool done{false};
+        std::size_t pending;
+        std::vector<mysql::pooled_connection> ready;
+        std::vector<std::shared_ptr<asio::cancellation_signal>> cancel;
+        std::shared_ptr<asio::steady_timer> timer;
+      };
+      auto warm = std::make_shared<WarmUp>();
+      warm->cb = std::move(cb);
+      warm->pending = n;
+      if (n == 0) {
+        warm->cb(WarmIO::IOResult::Ok(0));
+        return;
+      }
+      auto executor = pool_.get_executor();
+      // Caller holds warm->mu; completes exactly once.
+      auto finish = [this, executor](const std::shared_ptr<WarmUp>& w,
+                                     std::unique_lock<std::mutex>& lock) {
+        w->done = true;
+        w->timer->cancel();
+        for (auto& signal : w->cancel) {
+          asio::dispatch(executor, [signal] {
+            signal->emit(asio::cancellation_type::terminal);
+          });
+        }
+        auto ready = std::move(w->ready);
+        lock.unlock();
+        for (auto& conn : ready) {
+          conn.return_without_reset();
+          release_permit();
+        }
+        DEBUG_PRINT("[MysqlPoolWrapper] warm_up ready=" << ready.size());
+        w->cb(WarmIO::IOResult::Ok(ready.size()));
+      };
+      warm->timer = std::make_shared<asio::steady_timer>(executor);
+      warm->timer->expires_after(deadline);
+      warm->timer->async_wait(
+          [warm, finish](const boost::system::error_code& ec) {
+            if (ec) return;
+            std::unique_lock<std::mutex> lock(warm->mu);
+            if (!warm->done) finish(warm, lock);
+          });
+      for (std::size_t i = 0; i < n; ++i) {
+        warm->cancel.push_back(std::make_shared<asio::cancellation_signal>());
+      }
+      // One attempt finished (conn empty when it failed or was cancelled).
+      // Its permit is released here unless the connection is kept, in
+      // which case finish() releases it after handing the connection back.
+      auto settle = [this, warm, finish,
+                     target = n](mysql::pooled_connection conn) {
+        std::unique_lock<std::mutex> lock(warm->mu);
+        if (warm->done || !conn.valid()) {
+          if (!warm->done && --warm->pending == 0) finish(warm, lock);
+          if (lock.owns_lock()) lock.unlock();
+          conn = mysql::pooled_connection();  // back with a reset
+          release_permit();
+          return;
+        }
+        --warm->pending;
+        warm->ready.push_back(std::move(conn));
+        if (warm->ready.size() >= target || warm->pending == 0) {
+          finish(warm, lock);
+        }
+      };
+      // Every connection is held until the warm-up completes, which forces
+      // the pool to open n distinct connections.
+      for (std::size_t i = 0; i < n; ++i) {
+        auto attempt = [this, warm, settle, signal = warm->cancel[i]] {
+          {
+            std::lock_guard<std::mutex> lock(warm->mu);
+            if (warm->done) {
+              // Granted after the deadline: pass the permit on.
+              release_permit();
+              return;
+            }
+          }
+          pool_.async_get_connection(asio::bind_cancellation_slot(
+              signal->slot(),
+              [this, settle](boost::system::error_code ec,
+                             mysql::pooled_connection conn) mutable {
+                if (ec) {
+                  if (is_connect_error(ec)) on_connect_failure();
+                  settle(mysql::pooled_connection());
+                  return;
+                }
+                auto holder = std::make_shared<mysql::pooled_connection>(
+                    std::move(conn));
+                auto results = std::make_shared<mysql::results>();
+                auto diag = std::make_shared<mysql::diagnostics>();
+                (*holder)->async_execute(
+                    kSessionSetupSql, *results, *diag,
+                    [this, settle, holder, results,
+                     diag](mysql::error_code setup_ec) mutable {
+                      if (setup_ec) {
+                        on_connect_failure();
+                      } else {
+                        on_connect_success();
+                      }
+                      settle(setup_ec ? mysql::pooled_connection()
+                                      : std::move(*holder));
+                    });
+              }));
+        };
+        acquire_permit(Priority::Background, [executor, attempt]() mutable {
+          asio::dispatch(executor, std::move(attempt));
+        });
+      }
+    });
+  }
+
+  // Lease tracking (MysqlConfig::lease_warn_ms). open_lease() returns null
+  // when it is disabled; `site` is only worth formatting when
+  // tracks_leases() is true.
+  using ConnLease = Lease<MysqlSessionState::TrackedPooledConn>;
+  bool tracks_leases() const { return config_.lease_warn_ms > 0; }
+  std::shared_ptr<ConnLease> open_lease(std::string site, uint64_t qid) {
+    if (!tracks_leases()) return nullptr;
+    return leases_.open(std::move(site), qid,
+                        std::chrono::steady_clock::now());
+  }
+  void close_lease(uint64_t id) noexcept { leases_.close(id); }
+  std::size_t outstanding_leases() const { return leases_.size(); }
+
+  // Concurrency limit changes. Set before traffic starts; invoked on the
+  // pool's io_context after every raise/lower decision.
+  using ResizeListener = std::function<void(const ResizeDecision&)>;
+  void on_resize(ResizeListener listener) {
+    resize_listener_ = std::move(listener);
+  }
+
+  // Sets the number of connections that may be handed out at once (clamped
+  // to [1, max_size]); waiters admitted by a larger capacity are dispatched
+  // on the pool executor.
+  void set_capacity(std::size_t capacity) {
+    capacity = std::clamp<std::size_t>(capacity, 1, config_.max_size);
+    for (auto& grant : gate_.set_capacity(capacity)) {
+      asio::post(pool_.get_executor(), std::move(grant));
+    }
+    metrics_.concurrency_limit.store(capacity, std::memory_order_relaxed);
+  }
+
   mysql::connection_pool& get() { return pool_; }
   const mysql::connection_pool& get() const { return pool_; }
   void inc_active() {
@@ -578,8 +1373,437 @@ struct MysqlPoolWrapper {
   int active() const { return active_conns_.load(); }
 
  private:
+  // boost::mysql's connection_pool cannot be resized after construction:
+  // it opens connections on demand up to max_size and keeps them. This is
+  // therefore a throttle, not a resize: it moves the priority gate's
+  // capacity, which bounds how many connections are in use at once (and
+  // how many get opened while it stays low). Lowering it retires nothing;
+  // connections opened under a higher limit stay open, idle.
+  void start_concurrency_throttle() {
+    PoolSizerOptions opts;
+    opts.ceiling = config_.max_size;
+    opts.floor = std::min<std::size_t>(
+        opts.ceiling,
+        std::max<uint64_t>(config_.elastic_min_size ? config_.elastic_min_size
+                                                    : config_.initial_size,
+                           1));
+    opts.target_wait =
+        std::chrono::milliseconds(config_.elastic_target_wait_ms);
+    opts.grow_step = config_.elastic_grow_step;
+    opts.cooldown = std::chrono::milliseconds(config_.elastic_cooldown_ms);
+    sizer_.emplace(opts);
+    set_capacity(opts.floor);
+    wait_snapshot_ = metrics_.acquire_wait.snapshot();
+    schedule_resize();
+  }
+
+  void schedule_resize() {
+    resize_timer_.expires_after(
+        std::chrono::milliseconds(config_.elastic_interval_ms));
+    resize_timer_.async_wait([this](const boost::system::error_code& ec) {
+      if (ec || stopped_) return;
+      evaluate_size();
+      schedule_resize();
+    });
+  }
+
+  void evaluate_size() {
+    auto snap = metrics_.acquire_wait.snapshot();
+    auto wait_p95 = LatencyHistogram::quantile(
+        LatencyHistogram::delta(snap, wait_snapshot_), 0.95);
+    wait_snapshot_ = snap;
+    auto decision =
+        sizer_->evaluate(gate_.capacity(), gate_.in_use(), wait_p95,
+                         std::chrono::steady_clock::now());
+    if (decision.action == ResizeAction::None) return;
+    set_capacity(decision.to);
+    (decision.action == ResizeAction::Raise ? metrics_.limit_raises
+                                            : metrics_.limit_lowers)
+        .fetch_add(1, std::memory_order_relaxed);
+    DEBUG_PRINT("[MysqlPoolWrapper] concurrency limit "
+                << decision.from << " -> " << decision.to
+                << " wait_p95_us=" << decision.wait_p95.count());
+    if (resize_listener_) resize_listener_(decision);
+  }
+
+  // Destroys generations that are retired (stopped and no longer current),
+  // idle and not pinned (see pin_current()). Destruction is posted so that
+  // handlers running right now finish with the pool first. While a retired
+  // generation is still pinned the prune is retried every kPruneRetry.
+  static constexpr auto kPruneRetry = std::chrono::seconds(1);
+  void prune_generations() {
+    auto retired =
+        std::make_shared<std::vector<std::shared_ptr<MysqlPoolWrapper>>>();
+    {
+      std::lock_guard<std::mutex> lock(generations_mutex_);
+      auto* live = current_.load(std::memory_order_acquire);
+      auto first_retired = std::stable_partition(
+          generations_.begin(), generations_.end(), [live](const auto& g) {
+            return g.get() == live || !g->stopped() || g->in_flight() > 0 ||
+                   g.use_count() > 1;
+          });
+      std::move(first_retired, generations_.end(),
+                std::back_inserter(*retired));
+      generations_.erase(first_retired, generations_.end());
+      bool held = std::any_of(
+          generations_.begin(), generations_.end(), [live](const auto& g) {
+            return g.get() != live && g->stopped();
+          });
+      if (held && !prune_armed_ && !shut_down_) {
+        prune_armed_ = true;
+        prune_timer_.expires_after(kPruneRetry);
+        prune_timer_.async_wait(
+            [this, alive = std::weak_ptr<void>(lifetime_)](
+                const boost::system::error_code& ec) {
+              if (alive.expired()) return;
+              {
+                std::lock_guard<std::mutex> lock(generations_mutex_);
+                prune_armed_ = false;
+              }
+              if (!ec) prune_generations();
+            });
+      }
+    }
+    if (retired->empty()) return;
+    DEBUG_PRINT("[MysqlPoolWrapper] pruning " << retired->size()
+                                              << " retired generation(s)");
+    asio::post(ioc_, [retired] { retired->clear(); });
+  }
+
+  // Ends a reload and starts the one queued meanwhile, if any.
+  void finish_reload() {
+    std::optional<MysqlConfig> pending;
+    {
+      std::lock_guard<std::mutex> lock(generations_mutex_);
+      reloading_ = false;
+      pending.swap(pending_reload_);
+    }
+    if (pending) {
+      asio::post(ioc_, [this, alive = std::weak_ptr<void>(lifetime_),
+                        next = std::move(*pending)] {
+        if (alive.expired()) return;
+        reload(next).run([](auto) {});
+      });
+    }
+  }
+
+  struct RunningStatement {
+    std::optional<uint32_t> connection_id;
+    std::shared_ptr<asio::cancellation_signal> cancel;
+  };
+
+  struct DrainState {
+    std::vector<MysqlPoolWrapper*> trees;
+    std::function<void(monad::IO<DrainReport>::IOResult)> cb;
+    DrainListener on_progress;
+    std::chrono::steady_clock::time_point started;
+    std::chrono::steady_clock::time_point deadline;
+    std::shared_ptr<asio::steady_timer> timer;
+    bool killing{false};
+    std::size_t killed{0};
+  };
+
+  // Visits this pool and every child pool.
+  template <class F>
+  void for_each_pool(F&& f) {
+    f(*this);
+    for (auto& replica : replicas_) replica->for_each_pool(f);
+    for (auto& partition : partitions_) partition->for_each_pool(f);
+    std::lock_guard<std::mutex> lock(shard_create_mutex_);
+    for (auto& shard : shard_owned_) shard->for_each_pool(f);
+    databases_.for_each([&f](MysqlPoolWrapper& db) { db.for_each_pool(f); });
+  }
+
+  std::size_t in_flight() {
+    std::size_t n = 0;
+    for_each_pool([&n](MysqlPoolWrapper& p) {
+      n += p.gate_.in_use() + p.gate_.waiting();
+    });
+    return n;
+  }
+
+  std::size_t kill_running() {
+    std::size_t killed = 0;
+    for_each_pool([&killed](MysqlPoolWrapper& p) {
+      std::vector<RunningStatement> victims;
+      {
+        std::lock_guard<std::mutex> lock(p.running_mutex_);
+        for (auto& [id, statement] : p.running_) victims.push_back(statement);
+      }
+      for (auto& victim : victims) {
+        if (victim.connection_id) p.kill_query(*victim.connection_id);
+        asio::dispatch(p.pool_.get_executor(), [signal = victim.cancel] {
+          signal->emit(asio::cancellation_type::terminal);
+        });
+      }
+      killed += victims.size();
+    });
+    return killed;
+  }
+
+  // drain() of the given pool trees (each with its child pools).
+  monad::IO<DrainReport> drain_trees(
+      std::vector<MysqlPoolWrapper*> trees,
+      std::chrono::steady_clock::duration deadline, DrainListener on_progress) {
+    using DrainIO = monad::IO<DrainReport>;
+    return DrainIO([this, trees = std::move(trees), deadline,
+                    on_progress = std::move(on_progress)](auto cb) mutable {
+      auto state = std::make_shared<DrainState>();
+      state->trees = std::move(trees);
+      state->cb = std::move(cb);
+      state->on_progress = std::move(on_progress);
+      state->started = std::chrono::steady_clock::now();
+      state->deadline = state->started + deadline;
+      state->timer = std::make_shared<asio::steady_timer>(pool_.get_executor());
+      for (auto* tree : state->trees) {
+        tree->for_each_pool([](MysqlPoolWrapper& p) {
+          p.draining_.store(true, std::memory_order_release);
+        });
+      }
+      DEBUG_PRINT("[MysqlPoolWrapper] draining " << state->trees.size()
+                                                 << " pool tree(s)");
+      asio::dispatch(pool_.get_executor(),
+                     [this, state] { drain_step(state); });
+    });
+  }
+
+  void drain_step(const std::shared_ptr<DrainState>& state) {
+    auto now = std::chrono::steady_clock::now();
+    DrainProgress progress;
+    for (auto* tree : state->trees) {
+      progress.in_flight += tree->in_flight();
+      progress.running += tree->running_statements();
+    }
+    progress.elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(
+        now - state->started);
+    if (!state->killing && now >= state->deadline &&
+        progress.in_flight > 0) {
+      state->killing = true;
+      for (auto* tree : state->trees) state->killed += tree->kill_running();
+      BOOST_LOG_SEV(lg_, boost::log::trivial::warning)
+          << "[MysqlPoolWrapper] drain deadline passed; killed "
+          << state->killed << " running statements, " << progress.in_flight
+          << " requests in flight";
+    }
+    progress.killing = state->killing;
+    if (state->on_progress) state->on_progress(progress);
+    if (progress.in_flight == 0 || now >= state->deadline + kDrainKillGrace) {
+      for (auto* tree : state->trees) tree->stop_pools();
+      DrainReport report;
+      report.clean = !state->killing;
+      report.killed = state->killed;
+      report.abandoned = progress.in_flight;
+      report.elapsed = progress.elapsed;
+      DEBUG_PRINT("[MysqlPoolWrapper] drained clean=" << report.clean
+                  << " killed=" << report.killed
+                  << " abandoned=" << report.abandoned);
+      auto cb = std::move(state->cb);
+      cb(monad::IO<DrainReport>::IOResult::Ok(std::move(report)));
+      return;
+    }
+    state->timer->expires_after(kDrainPoll);
+    state->timer->async_wait(
+        [this, state](const boost::system::error_code& ec) {
+          if (!ec) drain_step(state);
+        });
+  }
+
+  // IO lag probe (root pool only): see MysqlConfig::io_lag_probe_ms.
+  void schedule_lag_probe() {
+    lag_timer_.expires_after(
+        std::chrono::milliseconds(config_.io_lag_probe_ms));
+    lag_timer_.async_wait([this](const boost::system::error_code& ec) {
+      if (ec || shut_down_) return;
+      // Measured from the expiry, the lag covers both the timer completion
+      // and the posted probe queueing behind whatever holds the thread.
+      asio::post(ioc_, [this, due = lag_timer_.expiry()] {
+        if (shut_down_) return;
+        auto sample =
+            lag_tracker_->record(std::chrono::steady_clock::now() - due);
+        if (sample.over) {
+          auto ms = [](auto d) {
+            return std::chrono::duration_cast<std::chrono::milliseconds>(d)
+                .count();
+          };
+          BOOST_LOG_SEV(lg_, boost::log::trivial::warning)
+              << "[MysqlPoolWrapper] IO thread lagged " << ms(sample.lag)
+              << "ms; slowest handler: "
+              << (sample.culprit.empty() ? "(untagged)" : sample.culprit)
+              << " (" << ms(sample.culprit_took) << "ms)";
+        }
+        schedule_lag_probe();
+      });
+    });
+  }
+
+  // Lease sweep: runs at half the smaller lease threshold. Leases past
+  // lease_warn_ms are logged once; leases past lease_reclaim_ms are
+  // reclaimed unless an operation is running on them.
+  void schedule_lease_sweep() {
+    auto threshold = config_.lease_warn_ms;
+    if (config_.lease_reclaim_ms > 0) {
+      threshold = std::min(threshold, config_.lease_reclaim_ms);
+    }
+    lease_timer_.expires_after(
+        std::chrono::milliseconds(std::max<uint64_t>(threshold / 2, 50)));
+    lease_timer_.async_wait([this](const boost::system::error_code& ec) {
+      if (ec || stopped_) return;
+      sweep_leases();
+      schedule_lease_sweep();
+    });
+  }
+
+  void sweep_leases() {
+    auto now = std::chrono::steady_clock::now();
+    auto sweep =
+        leases_.sweep(std::chrono::milliseconds(config_.lease_warn_ms),
+                      std::chrono::milliseconds(config_.lease_reclaim_ms), now);
+    for (auto& lease : sweep.warn) {
+      metrics_.leases_warned.fetch_add(1, std::memory_order_relaxed);
+      BOOST_LOG_SEV(lg_, boost::log::trivial::warning)
+          << "[MysqlPoolWrapper] connection to " << config_.host << ":"
+          << config_.port << " held for "
+          << std::chrono::duration_cast<std::chrono::milliseconds>(
+                 now - lease->acquired_at)
+                 .count()
+          << "ms qid=" << lease->qid << " site="
+          << (lease->site.empty() ? "?" : lease->site);
+    }
+    for (auto& lease : sweep.reclaim) reclaim(*lease);
+  }
+
+  // Takes the connection and permit away from a lease's holder. The holder
+  // later finds its connection invalid (begin_use() is false); the
+  // connection goes back to the pool with a reset.
+  void reclaim(ConnLease& lease) {
+    mysql::pooled_connection taken;
+    MysqlPoolWrapper* owner = nullptr;
+    {
+      std::lock_guard<std::mutex> lock(lease.mu);
+      if (lease.busy || lease.reclaimed || !lease.holder) return;
+      taken = std::move(lease.holder->inner);
+      owner = std::exchange(lease.holder->permit_owner, nullptr);
+      lease.reclaimed = true;
+      lease.holder = nullptr;
+    }
+    bool returned = taken.valid();
+    taken = mysql::pooled_connection();
+    metrics_.leases_reclaimed.fetch_add(1, std::memory_order_relaxed);
+    BOOST_LOG_SEV(lg_, boost::log::trivial::warning)
+        << "[MysqlPoolWrapper] reclaimed connection lease qid=" << lease.qid
+        << " site=" << (lease.site.empty() ? "?" : lease.site);
+    if (owner) {
+      release_pool_permit(owner, returned, true, lease.id);
+    } else {
+      leases_.close(lease.id);
+    }
+  }
+
+  // Wakes waiters held back by connection pacing once a token is due. At
+  // most one wake-up is pending; it re-arms itself while waiters remain
+  // blocked.
+  void arm_pacing() noexcept {
+    auto at = gate_.pacing_wakeup();
+    if (!at || stopped_) return;
+    std::lock_guard<std::mutex> lock(pace_mutex_);
+    if (pace_armed_) return;
+    pace_armed_ = true;
+    metrics_.connects_paced.fetch_add(1, std::memory_order_relaxed);
+    try {
+      pace_timer_.expires_at(*at);
+      pace_timer_.async_wait([this](const boost::system::error_code& ec) {
+        {
+          std::lock_guard<std::mutex> lock(pace_mutex_);
+          pace_armed_ = false;
+        }
+        if (ec || stopped_) return;
+        for (auto& grant : gate_.admit_ready()) {
+          asio::post(pool_.get_executor(), std::move(grant));
+        }
+        arm_pacing();
+      });
+    } catch (...) {
+      pace_armed_ = false;
+    }
+  }
+
+  static AdmissionOptions admission_options(const MysqlConfig& config) {
+    AdmissionOptions opts;
+    auto max_inflight = config.admission_max_inflight
+                            ? config.admission_max_inflight
+                            : 4 * config.max_size;
+    opts.max_limit = static_cast<double>(std::max<uint64_t>(max_inflight, 1));
+    opts.breaker_threshold = static_cast<uint32_t>(config.breaker_threshold);
+    opts.breaker_open = std::chrono::milliseconds(config.breaker_open_ms);
+    return opts;
+  }
+
+  MysqlConfig config_;
+  asio::io_context& ioc_;
+  // Declared before pool_ so the cached TLS context outlives the pool's
+  // connections.
+  std::shared_ptr<SslContextCache::Entry> tls_;
   mysql::connection_pool pool_;
-  bool stopped_{false};
+  // stopped_: this pool is closed; shut_down_: the whole wrapper is (see
+  // stop() and stop_pools()).
+  std::atomic<bool> stopped_{false};
+  std::atomic<bool> shut_down_{false};
+  std::atomic<bool> draining_{false};
   std::atomic<int> active_conns_{0};
+  PoolMetrics metrics_;
+  PriorityGate gate_{static_cast<std::size_t>(config_.max_size),
+                     std::chrono::milliseconds(config_.priority_aging_ms)};
+  AdmissionController admission_{admission_options(config_)};
+  std::optional<PoolSizer> sizer_;
+  LatencyHistogram::Snapshot wait_snapshot_{};
+  asio::steady_timer resize_timer_{ioc_};
+  LeaseRegistry<MysqlSessionState::TrackedPooledConn> leases_;
+  asio::steady_timer lease_timer_{ioc_};
+  std::optional<IoLagTracker> lag_tracker_;
+  asio::steady_timer lag_timer_{ioc_};
+  std::mutex running_mutex_;
+  uint64_t running_seq_{0};
+  std::unordered_map<uint64_t, RunningStatement> running_;
+  boost::log::sources::severity_logger<boost::log::trivial::severity_level>
+      lg_;
+  std::mutex pace_mutex_;
+  bool pace_armed_{false};
+  asio::steady_timer pace_timer_{ioc_};
+  ResizeListener resize_listener_;
+  std::vector<std::unique_ptr<MysqlPoolWrapper>> replicas_;
+  std::atomic<std::size_t> replica_rr_{0};
+  std::vector<std::unique_ptr<MysqlPoolWrapper>> partitions_;
+  ShardMap shard_map_;
+  std::vector<std::atomic<MysqlPoolWrapper*>> shard_pools_;
+  std::mutex shard_create_mutex_;
+  std::vector<std::unique_ptr<MysqlPoolWrapper>> shard_owned_;
+  PoolRegistry<MysqlConfig, MysqlPoolWrapper> databases_{config_.databases};
+  // Shared with reload generations that keep tenant_limits.
+  std::shared_ptr<TenantLimiter> tenants_;
+  // Hot reload (see reload()).
+  IMysqlConfigProvider* config_provider_{nullptr};
+  uint64_t reload_subscription_{0};
+  std::atomic<MysqlPoolWrapper*> current_{nullptr};
+  std::mutex generations_mutex_;
+  std::vector<std::shared_ptr<MysqlPoolWrapper>> generations_;
+  bool reloading_{false};
+  std::optional<MysqlConfig> pending_reload_;
+  bool prune_armed_{false};
+  asio::steady_timer prune_timer_{ioc_};
+  // Expires first thing in the destructor; handlers posted to the
+  // io_context hold it weakly and skip a wrapper that is gone.
+  std::shared_ptr<void> lifetime_ = std::make_shared<char>();
 };
+
+inline void release_pool_permit(MysqlPoolWrapper* pool, bool returned,
+                                bool reset, uint64_t lease_id) noexcept {
+  if (lease_id) pool->close_lease(lease_id);
+  if (returned) {
+    (reset ? pool->metrics().returns_with_reset
+           : pool->metrics().returns_without_reset)
+        .fetch_add(1, std::memory_order_relaxed);
+  }
+  pool->admission().release();
+  pool->release_permit();
+}
 }  // namespace sql
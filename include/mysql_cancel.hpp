@@ -0,0 +1,82 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <utility>
+
+namespace sql {
+
+// CancelToken
+// --------------------------------------------------------------------
+// Cooperative cancellation for queries (QueryOptions::cancel). The owner of
+// a request (e.g. an HTTP handler whose client went away) calls cancel();
+// the stages currently using the token get notified through the handlers
+// they subscribed and stop: a pending acquisition gives up its place, an
+// in-flight statement is aborted. Stages that start later see cancelled()
+// and fail without touching the pool.
+//
+// Thread-safe. Handlers run exactly once, on the thread calling cancel()
+// (or inside subscribe() if the token is already cancelled), never under
+// the token's lock.
+class CancelToken {
+ public:
+  using Handler = std::function<void()>;
+
+  static std::shared_ptr<CancelToken> make() {
+    return std::make_shared<CancelToken>();
+  }
+
+  // Returns false if the token had already been cancelled.
+  bool cancel() {
+    std::map<uint64_t, Handler> handlers;
+    {
+      std::lock_guard<std::mutex> lock(mu_);
+      if (cancelled_) return false;
+      cancelled_ = true;
+      handlers.swap(handlers_);
+    }
+    for (auto& [id, handler] : handlers) handler();
+    return true;
+  }
+
+  bool cancelled() const {
+    std::lock_guard<std::mutex> lock(mu_);
+    return cancelled_;
+  }
+
+  // Registers `handler` and returns its id for unsubscribe(). On a token
+  // that is already cancelled the handler runs right away and 0 is returned.
+  uint64_t subscribe(Handler handler) {
+    {
+      std::lock_guard<std::mutex> lock(mu_);
+      if (!cancelled_) {
+        auto id = ++next_id_;
+        handlers_.emplace(id, std::move(handler));
+        return id;
+      }
+    }
+    handler();
+    return 0;
+  }
+
+  void unsubscribe(uint64_t id) {
+    std::lock_guard<std::mutex> lock(mu_);
+    handlers_.erase(id);
+  }
+
+  std::size_t subscribers() const {
+    std::lock_guard<std::mutex> lock(mu_);
+    return handlers_.size();
+  }
+
+ private:
+  mutable std::mutex mu_;
+  bool cancelled_{false};
+  uint64_t next_id_{0};
+  std::map<uint64_t, Handler> handlers_;
+};
+
+}  // namespace sql
@@ -1,9 +1,17 @@
 #pragma once
 
+#include <atomic>
 #include <boost/json.hpp>
+#include <deque>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
 
 #include "json_util.hpp"
 #include "log_stream.hpp"
+#include "mysql_tenant.hpp"
 #include "simple_data.hpp"
 
 namespace json = boost::json;
@@ -12,6 +20,8 @@ namespace sql {
 enum class MysqlSwitch { Off, On };
 
 struct MysqlConfig {
+  // Entry name for "partitions" and "databases"; empty for the main pool.
+  std::string name;
   std::string host;
   int port;
   std::string username;
@@ -29,6 +39,148 @@ struct MysqlConfig {
   uint64_t initial_size{1};
   uint64_t max_size{151};
   uint64_t ping_interval{3600};  // seconds, 0 to disable
+  // Pacing of new connections (0 disables): at most connect_rate_per_sec
+  // sustained, connect_burst at once. While acquisitions keep failing the
+  // pool backs off exponentially from connect_backoff_base_ms up to
+  // connect_backoff_max_ms (jittered); requests queue meanwhile.
+  uint64_t connect_rate_per_sec{0};
+  uint64_t connect_burst{4};
+  uint64_t connect_backoff_base_ms{100};
+  uint64_t connect_backoff_max_ms{10000};
+  // Lease tracking (0 disables): connections held longer than lease_warn_ms
+  // are logged once with their acquire site and qid; with lease_reclaim_ms
+  // set, idle leases held that long are taken back by force.
+  uint64_t lease_warn_ms{0};
+  uint64_t lease_reclaim_ms{0};
+  // Bound for in-flight work of a pool replaced by a config reload to
+  // finish before its stragglers are killed (see MysqlPoolWrapper::reload).
+  uint64_t drain_timeout_ms{30000};
+  // Retry of transient failures (see sql::RetryPolicy): total attempts per
+  // query (1 disables) and the exponential backoff bounds between them.
+  uint64_t retry_max_attempts{1};
+  uint64_t retry_base_delay_ms{20};
+  uint64_t retry_max_delay_ms{500};
+  // Event-loop lag monitor of the IO thread (see sql::IoLagTracker): probe
+  // interval (0 disables) and the lag from which a probe is logged with the
+  // slowest handler that ran since the previous one (0: never logged).
+  uint64_t io_lag_probe_ms{0};
+  uint64_t io_lag_warn_ms{50};
+  // Default bound for acquiring a connection from this pool when a query
+  // does not specify one.
+  uint64_t acquire_timeout_ms{5000};
+  // Priority gate aging: a queued acquisition gains one priority level per
+  // interval so low-priority work is not starved indefinitely.
+  uint64_t priority_aging_ms{500};
+  // Admission control: requests waiting for or holding a connection are
+  // capped by an adaptive limit of at most admission_max_inflight (0 means
+  // 4 * max_size); callers beyond it fail fast. breaker_threshold consecutive
+  // acquisition failures reject everything for breaker_open_ms (0 disables
+  // the breaker).
+  uint64_t admission_max_inflight{0};
+  uint64_t breaker_threshold{5};
+  uint64_t breaker_open_ms{1000};
+  // Concurrency throttling (enabled when elastic_target_wait_ms > 0): every
+  // elastic_interval_ms the number of connections that may be in use at
+  // once is raised by up to elastic_grow_step while the acquire-wait p95
+  // exceeds the target, and lowered toward elastic_min_size (0 means
+  // initial_size) once waits are low and the limit has not moved for
+  // elastic_cooldown_ms. max_size stays the hard ceiling. Lowering the
+  // limit never closes connections: whatever the pool has opened stays
+  // open (and held by the server) until the pool is stopped or reloaded.
+  uint64_t elastic_target_wait_ms{0};
+  uint64_t elastic_min_size{0};
+  uint64_t elastic_grow_step{4};
+  uint64_t elastic_interval_ms{1000};
+  uint64_t elastic_cooldown_ms{30000};
+  // Read replicas of this server. Each entry in the JSON "replicas" array is
+  // an object overriding any of host/port/username/password/unix_socket;
+  // everything else is inherited from the primary.
+  std::vector<MysqlConfig> replicas;
+  // Read-your-writes: upper bound a replica read waits for the session's
+  // last written GTID set (WAIT_FOR_EXECUTED_GTID_SET) before falling back to
+  // the primary. 0 disables the wait and always falls back when a write is
+  // pending.
+  uint64_t gtid_wait_timeout_ms{50};
+  // Hedged replica reads: extra requests may not exceed this share of
+  // replica reads (percent), and a hedge is never sent earlier than
+  // hedge_min_delay_ms even when the replica's p95 is lower.
+  uint64_t hedge_budget_percent{5};
+  uint64_t hedge_min_delay_ms{2};
+  // Workload-class partitions: separate pools against the same server so
+  // long reports cannot starve interactive traffic. JSON is an object of
+  // name -> overlay, e.g.
+  //   "partitions": { "report": { "max_size": 4, "acquire_timeout_ms": 30000 },
+  //                   "batch":  { "max_size": 8 } }
+  std::vector<MysqlConfig> partitions;
+  // Horizontal shards (see sql::ShardMap in mysql_shard.hpp). Entries use the
+  // same overlay format as replicas.
+  std::vector<MysqlConfig> shards;
+  // Further schemas or servers used by the same process, addressed by name
+  // (QueryOptions::database). Each becomes a pool created on first use that
+  // shares this pool's IO thread and, for identical server + certificates,
+  // its SSL context. Object of name -> overlay, e.g.
+  //   "databases": { "billing": { "host": "billing-db", "database": "billing",
+  //                               "max_size": 8 } }
+  std::vector<MysqlConfig> databases;
+  // Per-tenant QPS and in-flight limits (QueryOptions::tenant), enforced on
+  // the session's pool. Object of tenant -> limits; "*" applies to tenants
+  // not listed, e.g.
+  //   "tenant_limits": { "*":    { "qps": 200, "max_in_flight": 8 },
+  //                      "acme": { "qps": 50, "burst": 100,
+  //                                "policy": "queue", "max_queue_ms": 250 } }
+  std::map<std::string, TenantLimits, std::less<>> tenant_limits;
+  std::string shard_strategy{"hash"};  // "hash" or "range"
+  std::vector<int64_t> shard_range_bounds;
+
+  // Field by field, nested entries included: any difference is a change a
+  // reload has to act on.
+  friend bool operator==(const MysqlConfig&, const MysqlConfig&) = default;
+
+  // Returns a copy of this config with the connection fields present in jo
+  // replaced. Used for replica / shard entries that only differ by endpoint.
+  MysqlConfig overlay(const json::object& jo) const {
+    MysqlConfig mc = *this;
+    mc.replicas.clear();
+    mc.shards.clear();
+    mc.partitions.clear();
+    mc.databases.clear();
+    if (auto* v = jo.if_contains("host")) {
+      mc.host = json::value_to<std::string>(*v);
+    }
+    if (auto* v = jo.if_contains("port")) mc.port = v->to_number<int>();
+    if (auto* v = jo.if_contains("username")) {
+      mc.username = json::value_to<std::string>(*v);
+    }
+    if (auto* v = jo.if_contains("password")) {
+      mc.password = json::value_to<std::string>(*v);
+    }
+    if (auto* v = jo.if_contains("database")) {
+      mc.database = json::value_to<std::string>(*v);
+    }
+    if (auto* v = jo.if_contains("unix_socket")) {
+      mc.unix_socket = json::value_to<std::string>(*v);
+    }
+    if (auto* v = jo.if_contains("ssl")) mc.ssl = v->to_number<int>();
+    if (auto* v = jo.if_contains("ca_str")) {
+      mc.ca_str = json::value_to<std::string>(*v);
+    }
+    if (auto* v = jo.if_contains("cert_str")) {
+      mc.cert_str = json::value_to<std::string>(*v);
+    }
+    if (auto* v = jo.if_contains("cert_key_str")) {
+      mc.cert_key_str = json::value_to<std::string>(*v);
+    }
+    if (auto* v = jo.if_contains("initial_size")) {
+      mc.initial_size = v->to_number<uint64_t>();
+    }
+    if (auto* v = jo.if_contains("max_size")) {
+      mc.max_size = v->to_number<uint64_t>();
+    }
+    if (auto* v = jo.if_contains("acquire_timeout_ms")) {
+      mc.acquire_timeout_ms = v->to_number<uint64_t>();
+    }
+    return mc;
+  }
 
   friend MysqlConfig tag_invoke(const json::value_to_tag<MysqlConfig>&,
                                 const json::value& jv) {
@@ -59,6 +211,155 @@ struct MysqlConfig {
       if (jo_p->if_contains("ping_interval")) {
         mc.ping_interval = jv.at("ping_interval").to_number<uint64_t>();
       }
+      if (jo_p->if_contains("connect_rate_per_sec")) {
+        mc.connect_rate_per_sec =
+            jv.at("connect_rate_per_sec").to_number<uint64_t>();
+      }
+      if (jo_p->if_contains("connect_burst")) {
+        mc.connect_burst = jv.at("connect_burst").to_number<uint64_t>();
+      }
+      if (jo_p->if_contains("connect_backoff_base_ms")) {
+        mc.connect_backoff_base_ms =
+            jv.at("connect_backoff_base_ms").to_number<uint64_t>();
+      }
+      if (jo_p->if_contains("connect_backoff_max_ms")) {
+        mc.connect_backoff_max_ms =
+            jv.at("connect_backoff_max_ms").to_number<uint64_t>();
+      }
+      if (jo_p->if_contains("lease_warn_ms")) {
+        mc.lease_warn_ms = jv.at("lease_warn_ms").to_number<uint64_t>();
+      }
+      if (jo_p->if_contains("lease_reclaim_ms")) {
+        mc.lease_reclaim_ms = jv.at("lease_reclaim_ms").to_number<uint64_t>();
+      }
+      if (jo_p->if_contains("drain_timeout_ms")) {
+        mc.drain_timeout_ms = jv.at("drain_timeout_ms").to_number<uint64_t>();
+      }
+      if (jo_p->if_contains("io_lag_probe_ms")) {
+        mc.io_lag_probe_ms = jv.at("io_lag_probe_ms").to_number<uint64_t>();
+      }
+      if (jo_p->if_contains("io_lag_warn_ms")) {
+        mc.io_lag_warn_ms = jv.at("io_lag_warn_ms").to_number<uint64_t>();
+      }
+      if (jo_p->if_contains("retry_max_attempts")) {
+        mc.retry_max_attempts =
+            jv.at("retry_max_attempts").to_number<uint64_t>();
+      }
+      if (jo_p->if_contains("retry_base_delay_ms")) {
+        mc.retry_base_delay_ms =
+            jv.at("retry_base_delay_ms").to_number<uint64_t>();
+      }
+      if (jo_p->if_contains("retry_max_delay_ms")) {
+        mc.retry_max_delay_ms =
+            jv.at("retry_max_delay_ms").to_number<uint64_t>();
+      }
+      if (jo_p->if_contains("acquire_timeout_ms")) {
+        mc.acquire_timeout_ms =
+            jv.at("acquire_timeout_ms").to_number<uint64_t>();
+      }
+      if (jo_p->if_contains("priority_aging_ms")) {
+        mc.priority_aging_ms =
+            jv.at("priority_aging_ms").to_number<uint64_t>();
+      }
+      if (jo_p->if_contains("admission_max_inflight")) {
+        mc.admission_max_inflight =
+            jv.at("admission_max_inflight").to_number<uint64_t>();
+      }
+      if (jo_p->if_contains("breaker_threshold")) {
+        mc.breaker_threshold =
+            jv.at("breaker_threshold").to_number<uint64_t>();
+      }
+      if (jo_p->if_contains("breaker_open_ms")) {
+        mc.breaker_open_ms = jv.at("breaker_open_ms").to_number<uint64_t>();
+      }
+      if (jo_p->if_contains("elastic_target_wait_ms")) {
+        mc.elastic_target_wait_ms =
+            jv.at("elastic_target_wait_ms").to_number<uint64_t>();
+      }
+      if (jo_p->if_contains("elastic_min_size")) {
+        mc.elastic_min_size = jv.at("elastic_min_size").to_number<uint64_t>();
+      }
+      if (jo_p->if_contains("elastic_grow_step")) {
+        mc.elastic_grow_step =
+            jv.at("elastic_grow_step").to_number<uint64_t>();
+      }
+      if (jo_p->if_contains("elastic_interval_ms")) {
+        mc.elastic_interval_ms =
+            jv.at("elastic_interval_ms").to_number<uint64_t>();
+      }
+      if (jo_p->if_contains("elastic_cooldown_ms")) {
+        mc.elastic_cooldown_ms =
+            jv.at("elastic_cooldown_ms").to_number<uint64_t>();
+      }
+      if (jo_p->if_contains("gtid_wait_timeout_ms")) {
+        mc.gtid_wait_timeout_ms =
+            jv.at("gtid_wait_timeout_ms").to_number<uint64_t>();
+      }
+      if (jo_p->if_contains("hedge_budget_percent")) {
+        mc.hedge_budget_percent =
+            jv.at("hedge_budget_percent").to_number<uint64_t>();
+      }
+      if (jo_p->if_contains("hedge_min_delay_ms")) {
+        mc.hedge_min_delay_ms =
+            jv.at("hedge_min_delay_ms").to_number<uint64_t>();
+      }
+      if (auto* replicas = jo_p->if_contains("replicas")) {
+        for (const auto& r : replicas->as_array()) {
+          mc.replicas.push_back(mc.overlay(r.as_object()));
+        }
+      }
+      if (auto* partitions = jo_p->if_contains("partitions")) {
+        for (const auto& [name, overlay] : partitions->as_object()) {
+          auto pc = mc.overlay(overlay.as_object());
+          pc.name = std::string(name);
+          mc.partitions.push_back(std::move(pc));
+        }
+      }
+      if (auto* shards = jo_p->if_contains("shards")) {
+        for (const auto& sh : shards->as_array()) {
+          mc.shards.push_back(mc.overlay(sh.as_object()));
+        }
+      }
+      if (auto* tenants = jo_p->if_contains("tenant_limits")) {
+        for (const auto& [name, entry] : tenants->as_object()) {
+          const auto& to = entry.as_object();
+          TenantLimits limits;
+          if (auto* v = to.if_contains("qps")) {
+            limits.qps = v->to_number<double>();
+          }
+          if (auto* v = to.if_contains("burst")) {
+            limits.burst = v->to_number<double>();
+          }
+          if (auto* v = to.if_contains("max_in_flight")) {
+            limits.max_in_flight = v->to_number<uint32_t>();
+          }
+          if (auto* v = to.if_contains("policy")) {
+            limits.policy = json::value_to<std::string>(*v) == "queue"
+                                ? TenantPolicy::Queue
+                                : TenantPolicy::Reject;
+          }
+          if (auto* v = to.if_contains("max_queue_ms")) {
+            limits.max_queue_wait =
+                std::chrono::milliseconds(v->to_number<uint64_t>());
+          }
+          mc.tenant_limits.emplace(std::string(name), limits);
+        }
+      }
+      if (auto* databases = jo_p->if_contains("databases")) {
+        for (const auto& [name, overlay] : databases->as_object()) {
+          auto dc = mc.overlay(overlay.as_object());
+          dc.name = std::string(name);
+          mc.databases.push_back(std::move(dc));
+        }
+      }
+      if (jo_p->if_contains("shard_strategy")) {
+        mc.shard_strategy =
+            json::value_to<std::string>(jv.at("shard_strategy"));
+      }
+      if (jo_p->if_contains("shard_range_bounds")) {
+        mc.shard_range_bounds =
+            json::value_to<std::vector<int64_t>>(jv.at("shard_range_bounds"));
+      }
       return mc;
     } else {
       throw std::runtime_error(
@@ -84,47 +385,202 @@ struct MysqlConfig {
     jo["username_socket"] = mysqlConfig.username_socket;
     jo["password_socket"] = mysqlConfig.password_socket;
     jo["thread_safe"] = mysqlConfig.thread_safe;
+    jo["initial_size"] = mysqlConfig.initial_size;
+    jo["max_size"] = mysqlConfig.max_size;
+    jo["ping_interval"] = mysqlConfig.ping_interval;
+    jo["connect_rate_per_sec"] = mysqlConfig.connect_rate_per_sec;
+    jo["connect_burst"] = mysqlConfig.connect_burst;
+    jo["connect_backoff_base_ms"] = mysqlConfig.connect_backoff_base_ms;
+    jo["connect_backoff_max_ms"] = mysqlConfig.connect_backoff_max_ms;
+    jo["lease_warn_ms"] = mysqlConfig.lease_warn_ms;
+    jo["lease_reclaim_ms"] = mysqlConfig.lease_reclaim_ms;
+    jo["drain_timeout_ms"] = mysqlConfig.drain_timeout_ms;
+    jo["retry_max_attempts"] = mysqlConfig.retry_max_attempts;
+    jo["retry_base_delay_ms"] = mysqlConfig.retry_base_delay_ms;
+    jo["retry_max_delay_ms"] = mysqlConfig.retry_max_delay_ms;
+    jo["io_lag_probe_ms"] = mysqlConfig.io_lag_probe_ms;
+    jo["io_lag_warn_ms"] = mysqlConfig.io_lag_warn_ms;
+    jo["acquire_timeout_ms"] = mysqlConfig.acquire_timeout_ms;
+    jo["priority_aging_ms"] = mysqlConfig.priority_aging_ms;
+    jo["admission_max_inflight"] = mysqlConfig.admission_max_inflight;
+    jo["breaker_threshold"] = mysqlConfig.breaker_threshold;
+    jo["breaker_open_ms"] = mysqlConfig.breaker_open_ms;
+    jo["elastic_target_wait_ms"] = mysqlConfig.elastic_target_wait_ms;
+    jo["elastic_min_size"] = mysqlConfig.elastic_min_size;
+    jo["elastic_grow_step"] = mysqlConfig.elastic_grow_step;
+    jo["elastic_interval_ms"] = mysqlConfig.elastic_interval_ms;
+    jo["elastic_cooldown_ms"] = mysqlConfig.elastic_cooldown_ms;
+    jo["gtid_wait_timeout_ms"] = mysqlConfig.gtid_wait_timeout_ms;
+    jo["hedge_budget_percent"] = mysqlConfig.hedge_budget_percent;
+    jo["hedge_min_delay_ms"] = mysqlConfig.hedge_min_delay_ms;
+    auto overlays = [](const std::vector<MysqlConfig>& entries) {
+      json::array arr;
+      for (const auto& r : entries) {
+        json::object ro;
+        ro["host"] = r.host;
+        ro["port"] = r.port;
+        ro["username"] = r.username;
+        ro["password"] = r.password;
+        ro["database"] = r.database;
+        ro["unix_socket"] = r.unix_socket;
+        ro["max_size"] = r.max_size;
+        arr.push_back(std::move(ro));
+      }
+      return arr;
+    };
+    if (!mysqlConfig.replicas.empty()) {
+      jo["replicas"] = overlays(mysqlConfig.replicas);
+    }
+    if (!mysqlConfig.partitions.empty()) {
+      json::object partitions;
+      for (const auto& pc : mysqlConfig.partitions) {
+        json::object po;
+        po["initial_size"] = pc.initial_size;
+        po["max_size"] = pc.max_size;
+        po["acquire_timeout_ms"] = pc.acquire_timeout_ms;
+        partitions[pc.name] = std::move(po);
+      }
+      jo["partitions"] = std::move(partitions);
+    }
+    if (!mysqlConfig.shards.empty()) {
+      jo["shards"] = overlays(mysqlConfig.shards);
+      jo["shard_strategy"] = mysqlConfig.shard_strategy;
+      jo["shard_range_bounds"] =
+          json::value_from(mysqlConfig.shard_range_bounds);
+    }
+    if (!mysqlConfig.tenant_limits.empty()) {
+      json::object tenants;
+      for (const auto& [name, limits] : mysqlConfig.tenant_limits) {
+        json::object to;
+        to["qps"] = limits.qps;
+        to["burst"] = limits.burst;
+        to["max_in_flight"] = limits.max_in_flight;
+        to["policy"] =
+            limits.policy == TenantPolicy::Queue ? "queue" : "reject";
+        to["max_queue_ms"] = limits.max_queue_wait.count();
+        tenants[name] = std::move(to);
+      }
+      jo["tenant_limits"] = std::move(tenants);
+    }
+    if (!mysqlConfig.databases.empty()) {
+      json::object databases;
+      for (const auto& dc : mysqlConfig.databases) {
+        json::object d = overlays({dc}).at(0).as_object();
+        d["ssl"] = dc.ssl;
+        d["ca_str"] = dc.ca_str;
+        d["cert_str"] = dc.cert_str;
+        d["cert_key_str"] = dc.cert_key_str;
+        d["initial_size"] = dc.initial_size;
+        d["acquire_timeout_ms"] = dc.acquire_timeout_ms;
+        databases[dc.name] = std::move(d);
+      }
+      jo["databases"] = std::move(databases);
+    }
     jv = std::move(jo);
   }
 };
 
 class IMysqlConfigProvider {
  public:
+  using ReloadListener = std::function<void(const MysqlConfig&)>;
   virtual ~IMysqlConfigProvider() = default;
+  // The current config. A reference may be dropped by a later reload();
+  // callers that keep the config copy it (MysqlPoolWrapper does).
   virtual const MysqlConfig& get() const = 0;
+  // Hot reload: re-reads the source and, if the config changed, notifies
+  // subscribers with the new one. Returns whether it changed. Providers
+  // without a reloadable source keep these defaults.
+  virtual bool reload() { return false; }
+  virtual uint64_t subscribe(ReloadListener) { return 0; }
+  virtual void unsubscribe(uint64_t) {}
 };
 
 class MysqlConfigProviderFile : public IMysqlConfigProvider {
-  MysqlConfig config_;
+  cjj365::AppProperties& app_properties_;
+  cjj365::ConfigSources& config_sources_;
   customio::IOutput& output_;
+  // The last kKeptVersions versions loaded, so a reference handed out by
+  // get() survives the next few reloads; current_ points at the newest.
+  static constexpr std::size_t kKeptVersions = 8;
+  std::deque<MysqlConfig> versions_;
+  std::atomic<const MysqlConfig*> current_{nullptr};
+  std::mutex mutex_;
+  uint64_t next_listener_{0};
+  std::map<uint64_t, ReloadListener> listeners_;
 
- public:
-  explicit MysqlConfigProviderFile(cjj365::AppProperties& app_properties,
-                                   cjj365::ConfigSources& config_sources,
-                                   customio::IOutput& output)
-      : output_(output) {
-    auto r = config_sources.json_content("mysql_config");
+  MysqlConfig load() {
+    auto r = config_sources_.json_content("mysql_config");
     if (r.is_err()) {
       output_.error() << "Failed to load MySQL config: " << r.error();
       throw std::runtime_error("Failed to load MySQL config.");
     }
     json::value jv = r.value();
-    jsonutil::substitue_envs(jv, config_sources.cli_overrides(),
-                             app_properties.properties);
-    config_ = json::value_to<MysqlConfig>(std::move(jv));
+    jsonutil::substitue_envs(jv, config_sources_.cli_overrides(),
+                             app_properties_.properties);
+    auto config = json::value_to<MysqlConfig>(std::move(jv));
     // if any value starts with "${", it means unresolved env var}"
-    if(config_.host.find("${") != std::string::npos ||
-       config_.username.find("${") != std::string::npos ||
-       config_.password.find("${") != std::string::npos ||
-       config_.database.find("${") != std::string::npos) {
+    if(config.host.find("${") != std::string::npos ||
+       config.username.find("${") != std::string::npos ||
+       config.password.find("${") != std::string::npos ||
+       config.database.find("${") != std::string::npos) {
       output_.error() << "MySQL config contains unresolved environment "
                          "variables.";
       throw std::runtime_error(
           "MySQL config contains unresolved environment variables.");
     }
+    return config;
+  }
+
+ public:
+  explicit MysqlConfigProviderFile(cjj365::AppProperties& app_properties,
+                                   cjj365::ConfigSources& config_sources,
+                                   customio::IOutput& output)
+      : app_properties_(app_properties),
+        config_sources_(config_sources),
+        output_(output) {
+    versions_.push_back(load());
+    current_.store(&versions_.back(), std::memory_order_release);
+  }
+
+  const MysqlConfig& get() const override {
+    return *current_.load(std::memory_order_acquire);
+  }
+
+  // A config that fails to load or validate is reported and ignored; the
+  // current one stays in effect.
+  bool reload() override {
+    std::map<uint64_t, ReloadListener> listeners;
+    const MysqlConfig* next = nullptr;
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      MysqlConfig config;
+      try {
+        config = load();
+      } catch (const std::exception& e) {
+        output_.error() << "MySQL config reload rejected: " << e.what();
+        return false;
+      }
+      if (config == get()) return false;
+      versions_.push_back(std::move(config));
+      if (versions_.size() > kKeptVersions) versions_.pop_front();
+      next = &versions_.back();
+      current_.store(next, std::memory_order_release);
+      listeners = listeners_;
+    }
+    for (auto& [id, listener] : listeners) listener(*next);
+    return true;
+  }
+
+  uint64_t subscribe(ReloadListener listener) override {
+    std::lock_guard<std::mutex> lock(mutex_);
+    listeners_.emplace(++next_listener_, std::move(listener));
+    return next_listener_;
   }
 
-  const MysqlConfig& get() const override { return config_; }
+  void unsubscribe(uint64_t id) override {
+    std::lock_guard<std::mutex> lock(mutex_);
+    listeners_.erase(id);
+  }
 };
 
-}  // namespace sql
\ No newline at end of file
+}  // namespace sql
@@ -0,0 +1,86 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <random>
+
+namespace sql {
+
+struct ConnectPacerOptions {
+  // Sustained new connections per second and how many may start at once.
+  double rate_per_sec{10};
+  double burst{4};
+  // Exponential backoff after failed establishment: base * 2^(failures-1),
+  // capped at max, each delay jittered to [50%, 100%].
+  std::chrono::milliseconds backoff_base{100};
+  std::chrono::milliseconds backoff_max{std::chrono::seconds(10)};
+};
+
+// ConnectPacer
+// --------------------------------------------------------------------
+// Token bucket for opening new connections, with a failure backoff. After a
+// failover every queued request would otherwise make the pool open a
+// connection in the same instant (TLS + auth for up to max_size sessions);
+// with the pacer they trickle in at rate_per_sec and stop entirely while
+// the server keeps refusing. Not synchronized; the owner serializes access.
+class ConnectPacer {
+ public:
+  using Clock = std::chrono::steady_clock;
+
+  explicit ConnectPacer(ConnectPacerOptions opts)
+      : opts_(opts), tokens_(opts.burst) {}
+
+  // Takes one token if the bucket has one and no backoff is in effect.
+  bool try_take(Clock::time_point now) {
+    refill(now);
+    if (now < blocked_until_ || tokens_ < 1) return false;
+    tokens_ -= 1;
+    return true;
+  }
+
+  // Earliest time try_take() can succeed.
+  Clock::time_point next_token_at(Clock::time_point now) {
+    refill(now);
+    auto at = now;
+    if (tokens_ < 1 && opts_.rate_per_sec > 0) {
+      at += std::chrono::duration_cast<Clock::duration>(
+          std::chrono::duration<double>((1 - tokens_) / opts_.rate_per_sec));
+    } else if (tokens_ < 1) {
+      at = Clock::time_point::max();
+    }
+    return std::max(at, blocked_until_);
+  }
+
+  void on_failure(Clock::time_point now) {
+    ++failures_;
+    auto shift = std::min<uint32_t>(failures_ - 1, 16);
+    auto delay = std::min(opts_.backoff_max, opts_.backoff_base * (1 << shift));
+    thread_local std::mt19937_64 rng{std::random_device{}()};
+    std::uniform_real_distribution<double> jitter(0.5, 1.0);
+    blocked_until_ =
+        now + std::chrono::duration_cast<Clock::duration>(delay * jitter(rng));
+  }
+
+  void on_success() { failures_ = 0; }
+
+  uint32_t failures() const { return failures_; }
+
+ private:
+  void refill(Clock::time_point now) {
+    if (last_refill_ != Clock::time_point{} && now > last_refill_) {
+      std::chrono::duration<double> elapsed = now - last_refill_;
+      tokens_ =
+          std::min(opts_.burst, tokens_ + elapsed.count() * opts_.rate_per_sec);
+    }
+    if (now > last_refill_) last_refill_ = now;
+  }
+
+  ConnectPacerOptions opts_;
+  double tokens_;
+  Clock::time_point last_refill_{};
+  Clock::time_point blocked_until_{};
+  uint32_t failures_{0};
+};
+
+}  // namespace sql
@@ -0,0 +1,179 @@
+#pragma once
+
+#include <boost/asio.hpp>  // IWYU pragma: keep
+#include <boost/mysql.hpp>
+#include <memory>
+#include <source_location>
+#include <string>
+#include <utility>
+
+#include "db_errors.hpp"
+#include "io_monad.hpp"
+#include "mysql_monad.hpp"
+#include "result_monad.hpp"
+
+namespace monad {
+
+// Coroutine API
+// --------------------------------------------------------------------
+// co_await-able counterparts of run_query(), run_prepared() and
+// transactions. Each one is the IO pipeline of MonadicMysqlSession turned
+// into an asio async operation, so routing, retries, deadlines, tenant
+// limits and cancellation behave exactly as in the IO style, and both
+// styles can be mixed on the same session:
+//
+//   asio::awaitable<MyVoidResult> rent(MonadicMysqlSession& s, int id) {
+//     auto r = co_await co_run_prepared(
+//         s, {}, "SELECT rental_id FROM rental WHERE customer_id = {}", id);
+//     if (r.is_err()) co_return MyVoidResult::Err(r.error());
+//     ...
+//   }
+//
+// Results come back as MyResult; as with IO, a statement the server
+// rejected is an Ok state whose has_error() is set (expect_no_error() and
+// friends turn it into an Err). The coroutine resumes on its own executor,
+// not on the MySQL IO thread. Coroutine frames come from asio's per-thread
+// recycling allocator, and so do the parked handler and the resumption
+// (see async_run()), so once those caches are warm awaiting a query adds no
+// malloc to its IO pipeline.
+
+// Runs `io` and completes `token` with its MyResult<T> on the executor
+// associated with the completion handler (for awaitables, the coroutine's).
+// The handler is parked in a block from its associated allocator (asio's
+// recycling allocator by default) so the IO callback stays copyable.
+template <class T, class CompletionToken = asio::use_awaitable_t<>>
+auto async_run(IO<T> io, CompletionToken&& token = {}) {
+  return asio::async_initiate<CompletionToken, void(MyResult<T>)>(
+      [](auto handler, IO<T> io) {
+        using Handler = decltype(handler);
+        auto alloc = asio::get_associated_allocator(
+            handler, asio::recycling_allocator<void>());
+        auto work = asio::make_work_guard(asio::get_associated_executor(
+            handler, asio::system_executor()));
+        using Pending = std::pair<Handler, decltype(work)>;
+        auto pending = std::allocate_shared<Pending>(alloc, std::move(handler),
+                                                     std::move(work));
+        std::move(io).run([pending, alloc](auto r) {
+          auto result = r.is_err() ? MyResult<T>::Err(std::move(r.error()))
+                                   : MyResult<T>::Ok(std::move(r.value()));
+          auto ex = pending->second.get_executor();
+          asio::dispatch(
+              ex, asio::bind_allocator(
+                      alloc, [pending, result = std::move(result)]() mutable {
+                        auto work = std::move(pending->second);
+                        std::move(pending->first)(std::move(result));
+                      }));
+        });
+      },
+      token, std::move(io));
+}
+
+inline asio::awaitable<MyResult<MysqlSessionState>> co_run_query(
+    MonadicMysqlSession& session, const std::string& sql,
+    const QueryOptions& opts = {},
+    std::source_location site = std::source_location::current()) {
+  return async_run(session.run_query(sql, opts, site));
+}
+
+// The call site travels in `format` (see PreparedFormat).
+template <class... Args>
+asio::awaitable<MyResult<MysqlSessionState>> co_run_prepared(
+    MonadicMysqlSession& session, const QueryOptions& opts,
+    PreparedFormat format, const Args&... args) {
+  return async_run(session.run_prepared(opts, format, args...));
+}
+
+// CoTransaction
+// --------------------------------------------------------------------
+// A transaction on one pooled connection (see
+// MonadicMysqlSession::begin_transaction()). Statements run one at a time;
+// commit() and rollback() end it and give the connection back. Destroying
+// an unfinished transaction returns its connection with a reset, which
+// rolls it back on the server.
+class CoTransaction {
+ public:
+  CoTransaction(std::shared_ptr<MonadicMysqlSession> session,
+                MysqlSessionState state, QueryOptions opts)
+      : session_(std::move(session)),
+        state_(std::move(state)),
+        opts_(std::move(opts)) {}
+
+  CoTransaction(CoTransaction&&) = default;
+  CoTransaction& operator=(CoTransaction&&) = default;
+
+  // Runs sql inside the transaction; its results are in last() afterwards.
+  // A statement the server rejected is an Err here (the transaction stays
+  // open, so the caller may still roll back); a lost connection ends it.
+  asio::awaitable<MyVoidResult> execute(std::string sql) {
+    if (!active()) co_return inactive();
+    auto r = co_await async_run(
+        session_->run_in(std::move(state_), sql, opts_));
+    if (r.is_err()) {
+      state_ = MysqlSessionState();
+      co_return MyVoidResult::Err(std::move(r.error()));
+    }
+    state_ = std::move(r.value());
+    if (state_.has_error()) {
+      co_return MyVoidResult::Err(state_.sql_failed_error());
+    }
+    co_return MyVoidResult();
+  }
+
+  asio::awaitable<MyVoidResult> commit() { return finish("COMMIT"); }
+  asio::awaitable<MyVoidResult> rollback() { return finish("ROLLBACK"); }
+
+  // Still holding its connection (not committed, rolled back or lost).
+  bool active() const { return state_.conn.valid(); }
+  // State of the most recent statement.
+  MysqlSessionState& last() { return state_; }
+
+ private:
+  asio::awaitable<MyVoidResult> finish(std::string sql) {
+    auto r = co_await execute(std::move(sql));
+    state_.conn.release();
+    co_return r;
+  }
+
+  static MyVoidResult inactive() {
+    return MyVoidResult::Err(Error{db_errors::SQL_EXEC::NO_CONNECTION,
+                                   "MySQL transaction is no longer active"});
+  }
+
+  std::shared_ptr<MonadicMysqlSession> session_;
+  MysqlSessionState state_;
+  QueryOptions opts_;
+};
+
+// Starts a transaction on the session's pool (the partition of
+// opts.workload); opts also applies to every statement run in it.
+inline asio::awaitable<MyResult<CoTransaction>> co_begin_transaction(
+    std::shared_ptr<MonadicMysqlSession> session, QueryOptions opts = {}) {
+  auto r = co_await async_run(session->begin_transaction(opts));
+  if (r.is_err()) {
+    co_return MyResult<CoTransaction>::Err(std::move(r.error()));
+  }
+  if (r.value().has_error()) {
+    co_return MyResult<CoTransaction>::Err(r.value().sql_failed_error());
+  }
+  co_return MyResult<CoTransaction>::Ok(CoTransaction(
+      std::move(session), std::move(r.value()), std::move(opts)));
+}
+
+// Runs `body` (CoTransaction& -> awaitable<MyVoidResult>) in a transaction:
+// committed when it returns Ok, rolled back when it returns Err.
+template <class Body>
+asio::awaitable<MyVoidResult> co_transaction(
+    std::shared_ptr<MonadicMysqlSession> session, Body body,
+    QueryOptions opts = {}) {
+  auto tx = co_await co_begin_transaction(std::move(session), std::move(opts));
+  if (tx.is_err()) co_return MyVoidResult::Err(std::move(tx.error()));
+  auto& t = tx.value();
+  auto r = co_await body(t);
+  if (r.is_err()) {
+    if (t.active()) co_await t.rollback();
+    co_return r;
+  }
+  co_return co_await t.commit();
+}
+
+}  // namespace monad
@@ -0,0 +1,108 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <string_view>
+
+#include "mysql_metrics.hpp"
+
+namespace sql {
+
+// IoLagTracker
+// --------------------------------------------------------------------
+// Event-loop lag of the MySQL IO thread. The pool posts a probe at a fixed
+// interval (MysqlConfig::io_lag_probe_ms) and feeds how late it ran to
+// record(); anything hogging the thread (continuations running inline,
+// TLS handshakes, row decoding) shows up as lag. Handlers that run user code
+// on the thread are bracketed with a Scope so that, when a probe comes in
+// over the threshold, the slowest tagged handler since the previous probe
+// can be named. Scopes cost two clock reads; only handlers slower than the
+// slowest one seen so far take the lock.
+class IoLagTracker {
+ public:
+  using Clock = std::chrono::steady_clock;
+
+  struct Sample {
+    Clock::duration lag{};
+    bool over{false};
+    // Slowest tagged handler since the previous probe ("" if none ran) and
+    // how long it took. Only filled in when `over`.
+    std::string culprit;
+    Clock::duration culprit_took{};
+  };
+
+  class Scope {
+   public:
+    Scope(IoLagTracker* tracker, std::string_view tag)
+        : tracker_(tracker), tag_(tag) {
+      if (tracker_) started_ = Clock::now();
+    }
+    ~Scope() {
+      if (tracker_) tracker_->handler_done(tag_, Clock::now() - started_);
+    }
+    Scope(const Scope&) = delete;
+    Scope& operator=(const Scope&) = delete;
+
+   private:
+    IoLagTracker* tracker_;
+    std::string_view tag_;
+    Clock::time_point started_{};
+  };
+
+  explicit IoLagTracker(Clock::duration threshold) : threshold_(threshold) {}
+
+  void handler_done(std::string_view tag, Clock::duration took) {
+    auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(took);
+    if (ns.count() <= slowest_ns_.load(std::memory_order_relaxed)) return;
+    std::lock_guard<std::mutex> lock(mu_);
+    if (ns.count() <= slowest_ns_.load(std::memory_order_relaxed)) return;
+    slowest_ns_.store(ns.count(), std::memory_order_relaxed);
+    slowest_tag_.assign(tag);
+  }
+
+  // One probe came in `lag` late. Starts a new window for handler tracking.
+  Sample record(Clock::duration lag) {
+    histogram_.record(lag);
+    auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(lag);
+    if (ns.count() > max_lag_ns_.load(std::memory_order_relaxed)) {
+      max_lag_ns_.store(ns.count(), std::memory_order_relaxed);
+    }
+    Sample sample;
+    sample.lag = lag;
+    sample.over = threshold_ > Clock::duration::zero() && lag >= threshold_;
+    std::lock_guard<std::mutex> lock(mu_);
+    if (sample.over) {
+      lagged_.fetch_add(1, std::memory_order_relaxed);
+      sample.culprit = std::move(slowest_tag_);
+      sample.culprit_took = std::chrono::nanoseconds(
+          slowest_ns_.load(std::memory_order_relaxed));
+    }
+    slowest_tag_.clear();
+    slowest_ns_.store(0, std::memory_order_relaxed);
+    return sample;
+  }
+
+  const LatencyHistogram& histogram() const { return histogram_; }
+  // Probes at or over the threshold.
+  uint64_t lagged() const { return lagged_.load(std::memory_order_relaxed); }
+  Clock::duration max_lag() const {
+    return std::chrono::nanoseconds(
+        max_lag_ns_.load(std::memory_order_relaxed));
+  }
+  Clock::duration threshold() const { return threshold_; }
+
+ private:
+  Clock::duration threshold_;
+  LatencyHistogram histogram_;
+  std::atomic<uint64_t> lagged_{0};
+  // Only written by record(), i.e. the IO thread.
+  std::atomic<int64_t> max_lag_ns_{0};
+  std::mutex mu_;
+  std::atomic<int64_t> slowest_ns_{0};
+  std::string slowest_tag_;
+};
+
+}  // namespace sql
@@ -0,0 +1,105 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace sql {
+
+// One borrowed connection: where and for which query it was acquired, and
+// since when. `Holder` is the object currently owning the connection; it
+// re-registers itself on every move so a forced reclaim can find it.
+template <class Holder>
+struct Lease {
+  using Clock = std::chrono::steady_clock;
+
+  uint64_t id{0};
+  uint64_t qid{0};
+  std::string site;
+  Clock::time_point acquired_at{};
+
+  // Guards the holder-side fields below.
+  std::mutex mu;
+  Holder* holder{nullptr};
+  // An operation is running on the connection; it must not be reclaimed.
+  bool busy{false};
+  bool reclaimed{false};
+};
+
+// LeaseRegistry
+// --------------------------------------------------------------------
+// Outstanding leases of one pool. A connection kept alive by a
+// MysqlSessionState captured in a long-lived lambda or forgotten on an
+// error path never goes back to the pool; sweep() reports such leases once
+// they are held longer than a threshold (each only once) and, optionally,
+// hands out the ones held long enough to be reclaimed by force.
+// Thread-safe.
+template <class Holder>
+class LeaseRegistry {
+ public:
+  using Clock = std::chrono::steady_clock;
+  using LeasePtr = std::shared_ptr<Lease<Holder>>;
+
+  struct Sweep {
+    std::vector<LeasePtr> warn;
+    std::vector<LeasePtr> reclaim;
+  };
+
+  LeasePtr open(std::string site, uint64_t qid, Clock::time_point now) {
+    auto lease = std::make_shared<Lease<Holder>>();
+    lease->qid = qid;
+    lease->site = std::move(site);
+    lease->acquired_at = now;
+    std::lock_guard<std::mutex> lock(mu_);
+    lease->id = ++next_id_;
+    leases_.emplace(lease->id, Entry{lease, false});
+    return lease;
+  }
+
+  void close(uint64_t id) {
+    std::lock_guard<std::mutex> lock(mu_);
+    leases_.erase(id);
+  }
+
+  // Leases held at least `warn_after` that were not reported before, and
+  // (when reclaim_after is non-zero) all leases held at least
+  // `reclaim_after`.
+  Sweep sweep(Clock::duration warn_after, Clock::duration reclaim_after,
+              Clock::time_point now) {
+    Sweep out;
+    std::lock_guard<std::mutex> lock(mu_);
+    for (auto& [id, entry] : leases_) {
+      auto held = now - entry.lease->acquired_at;
+      if (!entry.warned && held >= warn_after) {
+        entry.warned = true;
+        out.warn.push_back(entry.lease);
+      }
+      if (reclaim_after > Clock::duration::zero() && held >= reclaim_after) {
+        out.reclaim.push_back(entry.lease);
+      }
+    }
+    return out;
+  }
+
+  std::size_t size() const {
+    std::lock_guard<std::mutex> lock(mu_);
+    return leases_.size();
+  }
+
+ private:
+  struct Entry {
+    LeasePtr lease;
+    bool warned;
+  };
+
+  mutable std::mutex mu_;
+  uint64_t next_id_{0};
+  std::unordered_map<uint64_t, Entry> leases_;
+};
+
+}  // namespace sql
@@ -0,0 +1,162 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <bit>
+#include <chrono>
+#include <cstdint>
+#include <optional>
+
+namespace sql {
+
+// LatencyHistogram
+// --------------------------------------------------------------------
+// Log2-bucketed latency histogram with lock-free record(). Bucket i counts
+// samples in [2^i, 2^(i+1)) microseconds, so quantiles are accurate to a
+// factor of two, which is plenty for "is this slower than usual" decisions.
+// To follow the recent distribution instead of the process lifetime, all
+// buckets are halved every kDecayEvery samples (approximate under
+// concurrency; counts stay monotonic per bucket between decays).
+class LatencyHistogram {
+ public:
+  static constexpr std::size_t kBuckets = 40;
+  static constexpr uint64_t kDecayEvery = 4096;
+
+  void record(std::chrono::steady_clock::duration d) noexcept {
+    auto us = std::chrono::duration_cast<std::chrono::microseconds>(d).count();
+    uint64_t v = us > 0 ? static_cast<uint64_t>(us) : 1;
+    std::size_t idx = static_cast<std::size_t>(std::bit_width(v)) - 1;
+    if (idx >= kBuckets) idx = kBuckets - 1;
+    buckets_[idx].fetch_add(1, std::memory_order_relaxed);
+    if (samples_.fetch_add(1, std::memory_order_relaxed) % kDecayEvery ==
+        kDecayEvery - 1) {
+      for (auto& b : buckets_) {
+        b.store(b.load(std::memory_order_relaxed) / 2,
+                std::memory_order_relaxed);
+      }
+    }
+  }
+
+  // Samples recorded since construction (not affected by decay).
+  uint64_t count() const noexcept {
+    return samples_.load(std::memory_order_relaxed);
+  }
+
+  using Snapshot = std::array<uint64_t, kBuckets>;
+
+  Snapshot snapshot() const noexcept {
+    Snapshot snap{};
+    for (std::size_t i = 0; i < kBuckets; ++i) {
+      snap[i] = buckets_[i].load(std::memory_order_relaxed);
+    }
+    return snap;
+  }
+
+  // Bucket counts recorded between two snapshots. Buckets that shrank
+  // because of decay count as zero, so the window is an approximation.
+  static Snapshot delta(const Snapshot& later, const Snapshot& earlier) {
+    Snapshot d{};
+    for (std::size_t i = 0; i < kBuckets; ++i) {
+      d[i] = later[i] > earlier[i] ? later[i] - earlier[i] : 0;
+    }
+    return d;
+  }
+
+  // Upper bound of the bucket holding quantile q (0 < q <= 1); zero when
+  // nothing was recorded yet.
+  std::chrono::microseconds quantile(double q) const noexcept {
+    return quantile(snapshot(), q);
+  }
+
+  static std::chrono::microseconds quantile(const Snapshot& snap,
+                                            double q) noexcept {
+    uint64_t total = 0;
+    for (auto n : snap) total += n;
+    if (total == 0) return std::chrono::microseconds(0);
+    auto target = static_cast<uint64_t>(q * static_cast<double>(total));
+    if (target == 0) target = 1;
+    uint64_t seen = 0;
+    for (std::size_t i = 0; i < kBuckets; ++i) {
+      seen += snap[i];
+      if (seen >= target) {
+        return std::chrono::microseconds(uint64_t{1} << (i + 1));
+      }
+    }
+    return std::chrono::microseconds(uint64_t{1} << kBuckets);
+  }
+
+ private:
+  std::array<std::atomic<uint64_t>, kBuckets> buckets_{};
+  std::atomic<uint64_t> samples_{0};
+};
+
+// Counters owned by each MysqlPoolWrapper. Plain atomics so they can be read
+// from any thread (exporters, tests) without coordination.
+struct PoolMetrics {
+  // async_execute duration of every statement run on the pool.
+  LatencyHistogram exec_latency;
+  // Time from admission until a connection was handed out (priority gate
+  // queueing included); drives concurrency throttling.
+  LatencyHistogram acquire_wait;
+  // Hedged replica reads (see MonadicMysqlSession::run_query).
+  std::atomic<uint64_t> replica_reads{0};
+  std::atomic<uint64_t> hedges_sent{0};
+  std::atomic<uint64_t> hedges_won{0};
+  // Admission control: fast rejections and circuit breaker openings.
+  std::atomic<uint64_t> rejected_overload{0};
+  std::atomic<uint64_t> rejected_circuit_open{0};
+  std::atomic<uint64_t> breaker_trips{0};
+  // Concurrency throttling: connections that may be in use at once and
+  // how often that limit moved. Open connections are not counted here.
+  std::atomic<uint64_t> concurrency_limit{0};
+  std::atomic<uint64_t> limit_raises{0};
+  std::atomic<uint64_t> limit_lowers{0};
+  // Statements that overran QueryOptions::exec_timeout, and client-side
+  // KILL QUERYs sent (for overruns, cancellation and drain).
+  std::atomic<uint64_t> query_timeouts{0};
+  std::atomic<uint64_t> queries_killed{0};
+  // Queries given up through QueryOptions::cancel (acquisition or
+  // execution).
+  std::atomic<uint64_t> queries_cancelled{0};
+  // How connections went back to the pool: a reset round trip, or
+  // return_without_reset for sessions left without state.
+  std::atomic<uint64_t> returns_with_reset{0};
+  std::atomic<uint64_t> returns_without_reset{0};
+  // Connection leases held past lease_warn_ms, and those taken back after
+  // lease_reclaim_ms.
+  std::atomic<uint64_t> leases_warned{0};
+  std::atomic<uint64_t> leases_reclaimed{0};
+  // Retry of transient failures: attempts re-issued, queries that
+  // succeeded on a retry, and queries that still failed transiently once
+  // out of attempts or budget.
+  std::atomic<uint64_t> retries{0};
+  std::atomic<uint64_t> retries_succeeded{0};
+  std::atomic<uint64_t> retries_exhausted{0};
+  // Times queued requests had to wait for a connection pacing token.
+  std::atomic<uint64_t> connects_paced{0};
+};
+
+// Hedged replica reads
+// --------------------------------------------------------------------
+// Replica latency samples needed before hedging kicks in; until then the
+// p95 is not meaningful and reads go to a single replica.
+inline constexpr uint64_t kHedgeMinSamples = 64;
+
+// When to send the hedge of a read on a replica with `latency`: its recent
+// p95, but never before min_delay. nullopt while there are too few samples.
+inline std::optional<std::chrono::steady_clock::duration> hedge_delay(
+    const LatencyHistogram& latency, std::chrono::milliseconds min_delay) {
+  if (latency.count() < kHedgeMinSamples) return std::nullopt;
+  return std::max<std::chrono::steady_clock::duration>(
+      latency.quantile(0.95), min_delay);
+}
+
+// Whether one more hedge keeps hedges within budget_percent of the replica
+// reads seen so far.
+inline bool hedge_within_budget(uint64_t replica_reads, uint64_t hedges_sent,
+                                uint64_t budget_percent) {
+  return (hedges_sent + 1) * 100 <= replica_reads * budget_percent;
+}
+
+}  // namespace sql
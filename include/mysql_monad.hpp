@@ -14,11 +14,24 @@
 #include <boost/move/utility_core.hpp>
 #include <boost/mysql.hpp>
 #include <boost/shared_ptr.hpp>
+#include <algorithm>
+#include <array>
+#include <cctype>
+#include <concepts>
+#include <format>
+#include <mutex>
+#include <optional>
+#include <random>
+#include <source_location>
+#include <string_view>
 
 #include "common_macros.hpp"
 #include "io_monad.hpp"
 #include "log_stream.hpp"
 #include "mysql_base.hpp"
+#include "mysql_cancel.hpp"
+#include "mysql_retry.hpp"
+#include "mysql_statement.hpp"
 #include "result_monad.hpp"
 
 namespace asio = boost::asio;
@@ -33,6 +46,99 @@ namespace monad {
 using MysqlSessionState = sql::MysqlSessionState;
 using MysqlPoolWrapper = sql::MysqlPoolWrapper;
 
+// Where a read may be served. Replica reads stay read-your-writes consistent
+// for the issuing session: they are gated on the GTID set of the session's
+// last write and fall back to the primary when the replica lags.
+enum class ReadRoute { Primary, Replica };
+
+// Per-call knobs for run_query(). Defaults reproduce the historical
+// run_query(sql) behavior.
+struct QueryOptions {
+  // Upper bound for acquiring a pooled connection. Unset means the target
+  // pool's acquire_timeout_ms (5s unless configured).
+  std::optional<std::chrono::milliseconds> timeout;
+  ReadRoute route{ReadRoute::Primary};
+  // Workload class ("interactive", "batch", "report", ...). Primary queries
+  // run on the partition of that name when one is configured, otherwise on
+  // the main pool.
+  std::string workload;
+  // Named database (MysqlConfig::databases) to run on instead of the
+  // session's pool; its pool is created on first use. Empty means the
+  // session's pool. Named pools have no replicas, so such queries always go
+  // to that database's primary (or its partition for `workload`). An
+  // unknown name fails with db_errors::POOL::UNKNOWN_DATABASE.
+  std::string database;
+  // Acquisition priority when the target pool is saturated. User-facing
+  // requests should use Interactive, background jobs Background/Batch.
+  sql::Priority priority{sql::Priority::Normal};
+  // Execution deadline of the statement itself (acquisition excluded).
+  // SELECTs also carry a MAX_EXECUTION_TIME hint so the server usually
+  // aborts them first. Otherwise, on expiry the statement is killed with
+  // KILL QUERY from a side connection, the victim connection is discarded
+  // and the IO fails with db_errors::SQL_EXEC::QUERY_TIMEOUT. So does a
+  // SELECT whose result only arrives after the limit (the hint cuts SLEEP()
+  // short without an error).
+  std::optional<std::chrono::milliseconds> exec_timeout;
+  // End of the whole request's latency budget. Every stage of a .then chain
+  // that carries it only gets what is left, for acquisition and execution
+  // alike, and a stage starting after it fails fast with
+  // db_errors::SQL_EXEC::DEADLINE_EXCEEDED without touching the pool. See
+  // also MonadicMysqlSession::set_deadline().
+  std::optional<std::chrono::steady_clock::time_point> deadline;
+  // Cooperative cancellation (see sql::CancelToken). Cancelling gives up a
+  // pending acquisition or kills the in-flight statement (KILL QUERY), whose
+  // connection is then discarded and reconnected by the pool; the IO fails
+  // with db_errors::SQL_EXEC::CANCELLED. A success that raced the cancel is
+  // still delivered.
+  std::shared_ptr<sql::CancelToken> cancel;
+  // Label reported for this query's connection lease when the pool tracks
+  // leases (MysqlConfig::lease_warn_ms) and by the IO lag monitor
+  // (io_lag_probe_ms); defaults to the file:line calling run_query.
+  std::string tag;
+  // Query id in lease reports; assigned by the session.
+  uint64_t qid{0};
+  // The statement (or the transaction sent as one multi-statement text)
+  // may safely run more than once. Enables hedging of replica reads when at
+  // least two replicas are configured, and retries after failures that may
+  // have been applied (see sql::RetryClass).
+  bool idempotent{false};
+  // Retry of transient failures; unset means the policy configured on the
+  // session's pool (retry_max_attempts, off by default). Retries stay within
+  // `deadline` and stop on `cancel`.
+  std::optional<sql::RetryPolicy> retry;
+  // Tenant the query is accounted to for the pool's "tenant_limits" (QPS
+  // and in-flight quotas, see sql::TenantLimiter). Over its limits the query
+  // fails with db_errors::POOL::TENANT_RATE_LIMITED or
+  // TENANT_IN_FLIGHT_LIMITED, or waits when the tenant's policy is "queue".
+  // Empty means not limited.
+  std::string tenant;
+  // Where the result is delivered, i.e. where the caller's .then
+  // continuations run: e.g. a CPU worker pool for heavy row decoding, or
+  // the caller's strand. Delivered inline when the completion already runs
+  // on it (asio::dispatch semantics). Unset keeps delivery on the MySQL IO
+  // thread, which stalls every other query's I/O while a continuation runs.
+  asio::any_io_executor completion_executor;
+};
+
+// Format string of run_prepared() together with the call site it was
+// written at. A defaulted std::source_location cannot follow the argument
+// pack, so it is taken when the literal converts here. Text known only at
+// run time goes through mysql::runtime().
+struct PreparedFormat {
+  template <class T>
+    requires std::convertible_to<const T&, std::string_view>
+  consteval PreparedFormat(
+      const T& text, std::source_location at = std::source_location::current())
+      : format(text), site(at) {}
+  constexpr PreparedFormat(
+      mysql::constant_string_view text,
+      std::source_location at = std::source_location::current())
+      : format(text), site(at) {}
+
+  mysql::constant_string_view format;
+  std::source_location site;
+};
+
 // Concurrency model:
 //  - Each run_query() acquires a pooled connection, runs one statement, returns
 //  it.
@@ -52,6 +158,11 @@ class MonadicMysqlSession
   asio::any_io_executor executor_;
   logsrc::severity_logger<trivial::severity_level> lg;
   customio::IOutput& output_;
+  mutable std::mutex gtid_mutex_;
+  std::string last_gtid_set_;
+  bool gtid_unknown_{false};
+  // steady_clock ticks of the session deadline, 0 when none is set.
+  std::atomic<std::chrono::steady_clock::rep> deadline_{0};
 
  public:
   using Factory = std::function<std::shared_ptr<MonadicMysqlSession>()>;
@@ -71,34 +182,205 @@ class MonadicMysqlSession
 
   IO<MysqlSessionState> run_query(
       const std::string& sql,
-      std::chrono::seconds timeout = std::chrono::seconds(5)) {
-    static std::atomic<long long> qid_counter{0};
-    long long qid = ++qid_counter;
-    // Capture log stream locally to ensure lifetime extends across chained <<
-    // operations. There have been intermittent crashes here
-    // (RegisterStrongPasswordSucceeds test) indicating a potential lifetime or
-    // UB issue when returning temporary LogStream. Defensive: wrap logging in
-    // try/catch; logging must never crash query execution path.
-    return get_connection(timeout).then(
-        [self = shared_from_this(), sql, qid](MysqlSessionState state) mutable {
-          if (state.has_error()) {
-            return IO<MysqlSessionState>::pure(std::move(state));
-          }
-          return self->execute_sql(std::move(state), sql);
-        });
+      std::chrono::seconds timeout = std::chrono::seconds(5),
+      std::source_location site = std::source_location::current()) {
+    QueryOptions opts;
+    opts.timeout = timeout;
+    return run_query(sql, opts, site);
+  }
+
+  // Read-your-writes routing:
+  //  - Statements on the primary that are not plain reads record the
+  //    primary's gtid_executed afterwards (one extra round trip on the
+  //    already-held connection, writes only). That is the server's set, not
+  //    just this session's writes, so a replica may be made to wait for
+  //    other clients' writes too: stricter than read-your-writes needs.
+  //  - ReadRoute::Replica reads pick a replica round-robin and first run
+  //    WAIT_FOR_EXECUTED_GTID_SET(<last write>, gtid_wait_timeout_ms). If the
+  //    replica does not catch up in time, or cannot be reached, the read is
+  //    re-issued on the primary.
+  //  - Without configured replicas everything runs on the primary and no
+  //    GTIDs are tracked.
+  // Deadlocks, lock wait timeouts, broken connections and acquisition
+  // timeouts are retried per QueryOptions::retry (also for run_query_on and
+  // run_query_on_pool) when that is safe for the statement.
+  IO<MysqlSessionState> run_query(
+      const std::string& sql, const QueryOptions& query_opts,
+      std::source_location site = std::source_location::current()) {
+    auto pin = pinned_pool();
+    if (!query_opts.database.empty()) {
+      auto* target = pin->database(query_opts.database);
+      if (!target) return unknown_database(query_opts.database);
+      auto scoped = query_opts;
+      scoped.database.clear();
+      return run_pinned(std::move(pin), target->partition(scoped.workload),
+                        sql, scoped, site);
+    }
+    auto budget = budgeted(query_opts, site);
+    if (!budget) return deadline_exceeded();
+    return guarded(std::move(pin), sql, *budget,
+                   [self = shared_from_this(), sql, opts = *budget] {
+      return self->route_query(sql, opts);
+    });
+  }
+
+  // Runs sql on the shard owning `key` (see sql::ShardMap). Shard pools are
+  // created lazily on first use. Without configured shards this is
+  // equivalent to run_query(sql, opts) on the primary.
+  template <class Key>
+  IO<MysqlSessionState> run_query_on(
+      const Key& key, const std::string& sql,
+      const QueryOptions& query_opts = {},
+      std::source_location site = std::source_location::current()) {
+    auto budget = budgeted(query_opts, site);
+    if (!budget) return deadline_exceeded();
+    const auto& opts = *budget;
+    auto pin = pinned_pool();
+    const auto& shards = pin->shard_map();
+    auto* target = shards.empty() ? nullptr
+                                  : &pin->shard_pool(shards.route(key));
+    return guarded(std::move(pin), sql, opts,
+                   [self = shared_from_this(), target, sql, opts] {
+                     return target ? self->run_on_pool(*target, sql, opts)
+                                   : self->run_on_primary(sql, opts);
+                   });
+  }
+
+  // Runs sql on an explicit pool (a shard, replica or any other pool that
+  // outlives this session). No routing, GTID tracking or fallback applies.
+  IO<MysqlSessionState> run_query_on_pool(
+      MysqlPoolWrapper& target, const std::string& sql,
+      const QueryOptions& query_opts = {},
+      std::source_location site = std::source_location::current()) {
+    return run_pinned(pinned_pool(), target, sql, query_opts, site);
+  }
+
+  // Parameterized statement: `format` uses {} placeholders that are filled
+  // with args, escaped and quoted by Boost.MySQL's client-side formatting
+  // (utf8mb4, backslash escapes on), then run like run_query(). One round
+  // trip, no server-side statement to deallocate. Unformattable arguments
+  // fail with db_errors::SQL_EXEC::SQL_FAILED. Leases and lag reports name
+  // the caller's file:line, as for run_query() (see PreparedFormat).
+  template <class... Args>
+  IO<MysqlSessionState> run_prepared(const QueryOptions& opts,
+                                     PreparedFormat format,
+                                     const Args&... args) {
+    std::string sql;
+    try {
+      sql = mysql::format_sql(
+          mysql::format_options{mysql::utf8mb4_charset, true}, format.format,
+          args...);
+    } catch (const boost::system::system_error& e) {
+      return IO<MysqlSessionState>::fail(
+          Error{db_errors::SQL_EXEC::SQL_FAILED,
+                std::string("Cannot format MySQL statement: ") + e.what()});
+    }
+    return run_query(sql, opts, format.site);
+  }
+
+  // Transactions: begin_transaction() acquires a connection from the
+  // session's pool (the partition of opts.workload) and runs START
+  // TRANSACTION on it; the returned state holds that connection. Run the
+  // statements with run_in(state, ...) and finish with run_in(state,
+  // "COMMIT") or "ROLLBACK". A state dropped before that returns its
+  // connection with a reset, which rolls the transaction back.
+  IO<MysqlSessionState> begin_transaction(
+      const QueryOptions& query_opts = {},
+      std::source_location site = std::source_location::current()) {
+    static const std::string kBegin = "START TRANSACTION";
+    auto budget = budgeted(query_opts, site);
+    if (!budget) return deadline_exceeded();
+    auto pin = pinned_pool();
+    auto* target = &pin->partition(budget->workload);
+    return guarded(std::move(pin), kBegin, *budget,
+                   [self = shared_from_this(), target, opts = *budget] {
+      return self->acquire(*target, opts)
+          .then([self, target, opts](MysqlSessionState state) {
+            if (state.has_error()) {
+              return IO<MysqlSessionState>::pure(std::move(state));
+            }
+            return self->execute_bounded(*target, std::move(state), kBegin,
+                                         opts);
+          });
+    });
+  }
+
+  // Runs sql on the connection `state` holds (see begin_transaction()) and
+  // hands the state back with the new results. Not retried: the statement
+  // belongs to the caller's transaction.
+  IO<MysqlSessionState> run_in(
+      MysqlSessionState state, const std::string& sql,
+      const QueryOptions& query_opts = {},
+      std::source_location site = std::source_location::current()) {
+    auto budget = budgeted(query_opts, site);
+    if (!budget) return deadline_exceeded();
+    auto* target = state.conn.valid() ? state.conn.permit_owner : nullptr;
+    if (!target) {
+      return IO<MysqlSessionState>::fail(
+          Error{db_errors::SQL_EXEC::NO_CONNECTION,
+                "MySQL statement needs a state holding a connection"});
+    }
+    // Balanced by execute_sql() like a fresh acquisition.
+    target->inc_active();
+    auto io = execute_bounded(*target, std::move(state), sql, *budget);
+    if (sql::leading_keyword(sql) == "COMMIT") {
+      io = std::move(io).then([self = shared_from_this(),
+                               sql](MysqlSessionState state) {
+        return self->capture_gtid(std::move(state), sql);
+      });
+    }
+    return deliver(*budget, std::move(io));
+  }
+
+  // Request-scoped deadline for every query issued through this session,
+  // typically set once by the code that created the session for a request.
+  // Combined with QueryOptions::deadline, the earlier one wins.
+  void set_deadline(std::chrono::steady_clock::time_point at) {
+    deadline_.store(at.time_since_epoch().count(), std::memory_order_relaxed);
+  }
+
+  void set_budget(std::chrono::steady_clock::duration budget) {
+    set_deadline(std::chrono::steady_clock::now() + budget);
+  }
+
+  void clear_deadline() { deadline_.store(0, std::memory_order_relaxed); }
+
+  // Time left until the session deadline (zero once spent), nullopt without
+  // one.
+  std::optional<std::chrono::steady_clock::duration> remaining_budget() const {
+    auto at = session_deadline();
+    if (!at) return std::nullopt;
+    return std::max<std::chrono::steady_clock::duration>(
+        *at - std::chrono::steady_clock::now(),
+        std::chrono::steady_clock::duration::zero());
+  }
+
+  // GTID set of this session's most recent write ("" if none yet).
+  std::string last_gtid_set() const {
+    std::lock_guard<std::mutex> lock(gtid_mutex_);
+    return last_gtid_set_;
   }
 
   IO<MysqlSessionState> run_query(
       std::function<MyResult<std::string>(mysql::pooled_connection&)>
           sql_generator,
-      std::chrono::seconds timeout = std::chrono::seconds(5)) {
-    static std::atomic<long long> qid_counter{0};
-    long long qid = ++qid_counter;
+      std::chrono::seconds timeout = std::chrono::seconds(5),
+      std::source_location site = std::source_location::current()) {
+    auto qid = next_qid();
 #ifdef BB_MYSQL_VERBOSE
     std::cerr << "[instrument] run_query(gen) ENTER qid=" << qid
               << " timeout=" << timeout.count() << "s" << std::endl;
 #endif
-    return get_connection(timeout).then(
+    std::chrono::steady_clock::duration wait = timeout;
+    if (auto left = remaining_budget()) {
+      if (*left == std::chrono::steady_clock::duration::zero()) {
+        return deadline_exceeded();
+      }
+      wait = std::min(wait, *left);
+    }
+    auto acquired = get_connection(pool(), wait, sql::Priority::Normal, nullptr,
+                                   lease_site({}, site), qid);
+    return std::move(acquired).then(
         [self = shared_from_this(), sql_generator = std::move(sql_generator),
          qid](MysqlSessionState state) mutable {
           if (state.has_error()) {
@@ -112,6 +394,9 @@ class MonadicMysqlSession
                     << " acquired pooled_connection handle_addr="
                     << raw_conn_ptr << std::endl;
 #endif
+          // The generator gets the raw connection and may change session
+          // state on it.
+          state.conn.needs_reset = true;
           auto sql = sql_generator(state.conn.get());
           if (sql.is_err()) {
             return IO<MysqlSessionState>::fail(std::move(sql.error()));
@@ -122,23 +407,657 @@ class MonadicMysqlSession
                 << "] executing SQL on conn_handle_addr=" << raw_conn_ptr
                 << ": " << sql.value() << std::endl;
           }
-          return self->execute_sql(std::move(state), sql.value());
+          auto text = std::move(sql.value());
+          QueryOptions opts;
+          opts.deadline = self->session_deadline();
+          return self->execute_bounded(self->pool(), std::move(state), text,
+                                       opts)
+              .then([self, text](MysqlSessionState state) {
+                return self->capture_gtid(std::move(state), text);
+              });
         });
   }
 
  private:
+  IO<MysqlSessionState> route_query(const std::string& sql,
+                                    const QueryOptions& opts) {
+    if (opts.route == ReadRoute::Replica && pool().has_replicas() &&
+        sql::is_read_only_statement(sql)) {
+      pool().metrics().replica_reads.fetch_add(1, std::memory_order_relaxed);
+      if (opts.idempotent && pool().replica_count() >= 2 && !write_pending()) {
+        return run_hedged(sql, opts);
+      }
+      return run_on_replica(sql, opts);
+    }
+    return run_on_primary(sql, opts);
+  }
+
+  IO<MysqlSessionState> run_on_pool(MysqlPoolWrapper& target,
+                                    const std::string& sql,
+                                    const QueryOptions& opts) {
+    return acquire(target, opts)
+        .then([self = shared_from_this(), sql, opts,
+               pool = &target](MysqlSessionState state) {
+          if (state.has_error()) {
+            return IO<MysqlSessionState>::pure(std::move(state));
+          }
+          return self->execute_bounded(*pool, std::move(state), sql, opts);
+        });
+  }
+
+  IO<MysqlSessionState> run_on_primary(const std::string& sql,
+                                       const QueryOptions& opts) {
+    // Capture log stream locally to ensure lifetime extends across chained <<
+    // operations. There have been intermittent crashes here
+    // (RegisterStrongPasswordSucceeds test) indicating a potential lifetime or
+    // UB issue when returning temporary LogStream. Defensive: wrap logging in
+    // try/catch; logging must never crash query execution path.
+    auto* target = &pool().partition(opts.workload);
+    return acquire(*target, opts)
+        .then([self = shared_from_this(), sql, opts,
+               target](MysqlSessionState state) mutable {
+          if (state.has_error()) {
+            return IO<MysqlSessionState>::pure(std::move(state));
+          }
+          return self->execute_bounded(*target, std::move(state), sql, opts)
+              .then([self, sql](MysqlSessionState state) {
+                return self->capture_gtid(std::move(state), sql);
+              });
+        });
+  }
+
+  IO<MysqlSessionState> run_on_replica(const std::string& sql,
+                                       const QueryOptions& opts) {
+    std::string gtid;
+    {
+      std::lock_guard<std::mutex> lock(gtid_mutex_);
+      if (gtid_unknown_) return run_on_primary(sql, opts);
+      gtid = last_gtid_set_;
+    }
+    if (!gtid.empty() && pool().config().gtid_wait_timeout_ms == 0) {
+      return run_on_primary(sql, opts);
+    }
+    auto* replica = &pool().pick_replica();
+    return acquire(*replica, opts)
+        .then([self = shared_from_this(), sql, opts, gtid,
+               replica](MysqlSessionState state) {
+          if (state.has_error()) {
+            // Replica unreachable or saturated; the primary can always
+            // serve the read.
+            return self->run_on_primary(sql, opts);
+          }
+          if (gtid.empty()) {
+            return self->execute_bounded(*replica, std::move(state), sql,
+                                         opts);
+          }
+          return self->wait_for_gtid(*replica, std::move(state), gtid)
+              .then([self, sql, opts, replica](MysqlSessionState state) {
+                if (!state.conn.valid()) {
+                  return self->run_on_primary(sql, opts);
+                }
+                return self->execute_bounded(*replica, std::move(state), sql,
+                                             opts);
+              });
+        });
+  }
+
+  static std::chrono::milliseconds acquire_timeout(
+      const MysqlPoolWrapper& target, const QueryOptions& opts) {
+    auto timeout = opts.timeout ? *opts.timeout : target.acquire_timeout();
+    if (opts.deadline) {
+      auto left = std::chrono::duration_cast<std::chrono::milliseconds>(
+          *opts.deadline - std::chrono::steady_clock::now());
+      timeout = std::max(std::min(timeout, left), std::chrono::milliseconds(0));
+    }
+    return timeout;
+  }
+
+  // get_connection() within what is left of opts.deadline. Also used by
+  // fallbacks (replica -> primary) so a spent budget is not retried.
+  IO<MysqlSessionState> acquire(MysqlPoolWrapper& target,
+                                const QueryOptions& opts) {
+    if (deadline_passed(opts)) return deadline_exceeded();
+    if (opts.cancel && opts.cancel->cancelled()) return cancelled_error();
+    return get_connection(target, acquire_timeout(target, opts),
+                          opts.priority, opts.cancel, opts.tag, opts.qid);
+  }
+
+  std::optional<std::chrono::steady_clock::time_point> session_deadline()
+      const {
+    auto ticks = deadline_.load(std::memory_order_relaxed);
+    if (ticks == 0) return std::nullopt;
+    return std::chrono::steady_clock::time_point(
+        std::chrono::steady_clock::duration(ticks));
+  }
+
+  // opts with the effective deadline (the earlier of the session's and its
+  // own), or nullopt when that deadline has already passed.
+  std::optional<QueryOptions> budgeted(const QueryOptions& opts,
+                                      const std::source_location& site) const {
+    QueryOptions out = opts;
+    out.qid = next_qid();
+    out.tag = lease_site(std::move(out.tag), site);
+    auto at = session_deadline();
+    if (at && (!out.deadline || *at < *out.deadline)) out.deadline = at;
+    if (deadline_passed(out)) return std::nullopt;
+    return out;
+  }
+
+  static uint64_t next_qid() {
+    static std::atomic<uint64_t> qid_counter{0};
+    return ++qid_counter;
+  }
+
+  sql::RetryPolicy retry_policy(const QueryOptions& opts) const {
+    if (opts.retry) return *opts.retry;
+    const auto& config = pool().config();
+    sql::RetryPolicy policy;
+    policy.max_attempts = static_cast<uint32_t>(config.retry_max_attempts);
+    policy.base_delay = std::chrono::milliseconds(config.retry_base_delay_ms);
+    policy.max_delay = std::chrono::milliseconds(config.retry_max_delay_ms);
+    return policy;
+  }
+
+  template <class Attempt>
+  struct RetryRun {
+    Attempt attempt;
+    sql::RetryPolicy policy;
+    bool idempotent;
+    bool single_statement;
+    std::optional<std::chrono::steady_clock::time_point> deadline;
+    std::shared_ptr<sql::CancelToken> cancel;
+    uint32_t attempts{0};
+  };
+
+  // Runs `attempt` and, while it fails transiently in a way that is safe to
+  // repeat (sql::may_retry), runs it again after the policy's backoff. The
+  // failed attempt's connection goes back to the pool before the pause.
+  // Gives up with the last failure once attempts run out, the pause would
+  // overrun opts.deadline, or opts.cancel fired.
+  template <class Attempt>
+  IO<MysqlSessionState> with_retry(const std::string& sql,
+                                   const QueryOptions& opts, Attempt attempt) {
+    auto policy = retry_policy(opts);
+    if (policy.max_attempts <= 1) return attempt();
+    auto run = std::make_shared<RetryRun<Attempt>>(RetryRun<Attempt>{
+        std::move(attempt), policy, opts.idempotent,
+        sql::statement_count(sql) == 1, opts.deadline, opts.cancel});
+    return IO<MysqlSessionState>([self = shared_from_this(), run](auto cb) {
+      self->retry_attempt(run, std::move(cb));
+    });
+  }
+
+  template <class Run, class Cb>
+  void retry_attempt(std::shared_ptr<Run> run, Cb cb) {
+    ++run->attempts;
+    run->attempt().run([self = shared_from_this(), run,
+                        cb = std::move(cb)](auto r) mutable {
+      auto& metrics = self->pool().metrics();
+      if (r.is_err() || !r.value().has_error()) {
+        if (r.is_ok() && run->attempts > 1) {
+          metrics.retries_succeeded.fetch_add(1, std::memory_order_relaxed);
+        }
+        cb(std::move(r));
+        return;
+      }
+      auto kind = sql::classify_failure(r.value().error);
+      if (!sql::may_retry(kind, run->idempotent, run->single_statement)) {
+        cb(std::move(r));
+        return;
+      }
+      auto delay = run->policy.backoff(run->attempts, retry_jitter());
+      if (run->attempts >= run->policy.max_attempts ||
+          (run->deadline &&
+           std::chrono::steady_clock::now() + delay >= *run->deadline) ||
+          (run->cancel && run->cancel->cancelled())) {
+        metrics.retries_exhausted.fetch_add(1, std::memory_order_relaxed);
+        cb(std::move(r));
+        return;
+      }
+      BOOST_LOG_SEV(self->lg, trivial::info)
+          << "[MonadicMysqlSession] transient failure ("
+          << r.value().error_message() << "), retry " << run->attempts
+          << " in " << delay.count() << "ms";
+      metrics.retries.fetch_add(1, std::memory_order_relaxed);
+      auto timer = std::make_shared<asio::steady_timer>(
+          self->pool().get().get_executor());
+      timer->expires_after(delay);
+      // `r`, and the failed attempt's connection with it, is released when
+      // this handler returns.
+      timer->async_wait([self, run, cb = std::move(cb),
+                         timer](const boost::system::error_code&) mutable {
+        self->retry_attempt(run, std::move(cb));
+      });
+    });
+  }
+
+  // Common wrapping of the public entry points, innermost first: retry of
+  // transient failures, tenant limits (of the pinned pool), delivery on the
+  // completion executor. `pin` is the generation the attempt was resolved
+  // against (see MysqlPoolWrapper::pin_current()); it is held until the
+  // result is delivered, so a reload cannot free it under the query.
+  template <class Attempt>
+  IO<MysqlSessionState> guarded(std::shared_ptr<MysqlPoolWrapper> pin,
+                                const std::string& sql,
+                                const QueryOptions& opts, Attempt attempt) {
+    auto io = with_retry(sql, opts, std::move(attempt));
+    io = with_tenant(pin->tenants(), opts, std::move(io));
+    auto pending = std::make_shared<IO<MysqlSessionState>>(
+        deliver(opts, std::move(io)));
+    return IO<MysqlSessionState>([pin = std::move(pin), pending](auto cb) {
+      std::move(*pending).run([pin, cb = std::move(cb)](auto r) mutable {
+        cb(std::move(r));
+      });
+    });
+  }
+
+  // run_query_on_pool() holding `pin` (see guarded()).
+  IO<MysqlSessionState> run_pinned(std::shared_ptr<MysqlPoolWrapper> pin,
+                                   MysqlPoolWrapper& target,
+                                   const std::string& sql,
+                                   const QueryOptions& query_opts,
+                                   std::source_location site) {
+    auto budget = budgeted(query_opts, site);
+    if (!budget) return deadline_exceeded();
+    return guarded(std::move(pin), sql, *budget,
+                   [self = shared_from_this(), sql, opts = *budget,
+                    pool = &target] {
+                     return self->run_on_pool(*pool, sql, opts);
+                   });
+  }
+
+  // Hands the result of `io` to opts.completion_executor. asio::dispatch
+  // runs it inline when already on that executor, and posts it otherwise.
+  IO<MysqlSessionState> deliver(const QueryOptions& opts,
+                                IO<MysqlSessionState> io) {
+    if (!opts.completion_executor) return io;
+    auto pending = std::make_shared<IO<MysqlSessionState>>(std::move(io));
+    return IO<MysqlSessionState>([pending,
+                                  ex = opts.completion_executor](auto cb) {
+      std::move(*pending).run([ex, cb = std::move(cb)](auto r) mutable {
+        asio::dispatch(ex, [cb = std::move(cb), r = std::move(r)]() mutable {
+          cb(std::move(r));
+        });
+      });
+    });
+  }
+
+  // Runs `io` once the tenant of opts has room under its limits, holding
+  // an in-flight slot until it completes. With TenantPolicy::Queue an
+  // over-limit query waits (re-checking when a token is due, or every
+  // TenantState::kInFlightRetry for the in-flight quota) up to the tenant's
+  // max_queue_wait and the query deadline; otherwise it fails right away.
+  IO<MysqlSessionState> with_tenant(sql::TenantLimiter& limiter,
+                                    const QueryOptions& opts,
+                                    IO<MysqlSessionState> io) {
+    if (opts.tenant.empty() || !limiter.enabled()) return io;
+    auto* tenant = &limiter.state(opts.tenant);
+    auto give_up_at =
+        std::chrono::steady_clock::now() + tenant->limits().max_queue_wait;
+    if (opts.deadline) give_up_at = std::min(give_up_at, *opts.deadline);
+    auto pending = std::make_shared<IO<MysqlSessionState>>(std::move(io));
+    return IO<MysqlSessionState>([self = shared_from_this(), tenant, pending,
+                                  give_up_at, cancel = opts.cancel](auto cb) {
+      self->tenant_admit(tenant, pending, give_up_at, cancel, false,
+                         std::move(cb));
+    });
+  }
+
+  template <class Cb>
+  void tenant_admit(sql::TenantState* tenant,
+                    std::shared_ptr<IO<MysqlSessionState>> pending,
+                    std::chrono::steady_clock::time_point give_up_at,
+                    std::shared_ptr<sql::CancelToken> cancel, bool queued,
+                    Cb cb) {
+    auto now = std::chrono::steady_clock::now();
+    auto verdict = tenant->try_acquire(now);
+    if (verdict.result == sql::TenantAdmission::Admitted) {
+      std::move(*pending).run([tenant, cb = std::move(cb)](auto r) mutable {
+        tenant->release();
+        cb(std::move(r));
+      });
+      return;
+    }
+    if (cancel && cancel->cancelled()) {
+      cb(IO<MysqlSessionState>::IOResult::Err(cancelled_error_value()));
+      return;
+    }
+    if (tenant->limits().policy == sql::TenantPolicy::Queue &&
+        now + verdict.retry_after < give_up_at) {
+      if (!queued) {
+        tenant->metrics().queued.fetch_add(1, std::memory_order_relaxed);
+      }
+      auto timer =
+          std::make_shared<asio::steady_timer>(pool().get().get_executor());
+      timer->expires_after(verdict.retry_after);
+      timer->async_wait([self = shared_from_this(), tenant, pending,
+                         give_up_at, cancel, timer, cb = std::move(cb)](
+                            const boost::system::error_code&) mutable {
+        self->tenant_admit(tenant, pending, give_up_at, cancel, true,
+                           std::move(cb));
+      });
+      return;
+    }
+    bool by_rate = verdict.result == sql::TenantAdmission::RateLimited;
+    (by_rate ? tenant->metrics().rejected_rate
+             : tenant->metrics().rejected_in_flight)
+        .fetch_add(1, std::memory_order_relaxed);
+    cb(IO<MysqlSessionState>::IOResult::Err(
+        by_rate ? Error{db_errors::POOL::TENANT_RATE_LIMITED,
+                        "MySQL tenant '" + tenant->name() +
+                            "' exceeded its query rate"}
+                : Error{db_errors::POOL::TENANT_IN_FLIGHT_LIMITED,
+                        "MySQL tenant '" + tenant->name() +
+                            "' exceeded its in-flight query limit"}));
+  }
+
+  static double retry_jitter() {
+    thread_local std::mt19937_64 rng{std::random_device{}()};
+    return std::uniform_real_distribution<double>(0.0, 1.0)(rng);
+  }
+
+  // Lease and lag-monitor label: the caller's tag, else file:line (only
+  // formatted when the pool tracks leases or IO lag).
+  std::string lease_site(std::string tag,
+                         const std::source_location& site) const {
+    if (!tag.empty() || (!pool().tracks_leases() && !pool_.lag_tracker())) {
+      return tag;
+    }
+    return std::format("{}:{}", site.file_name(), site.line());
+  }
+
+  static bool deadline_passed(const QueryOptions& opts) {
+    return opts.deadline &&
+           *opts.deadline <= std::chrono::steady_clock::now();
+  }
+
+  static IO<MysqlSessionState> deadline_exceeded() {
+    return IO<MysqlSessionState>::fail(
+        Error{db_errors::SQL_EXEC::DEADLINE_EXCEEDED,
+              "MySQL request deadline exceeded"});
+  }
+
+  static IO<MysqlSessionState> unknown_database(const std::string& name) {
+    return IO<MysqlSessionState>::fail(
+        Error{db_errors::POOL::UNKNOWN_DATABASE,
+              "No MySQL database configured as '" + name + "'"});
+  }
+
+  static Error cancelled_error_value() {
+    return Error{db_errors::SQL_EXEC::CANCELLED, "MySQL query cancelled"};
+  }
+
+  static IO<MysqlSessionState> cancelled_error() {
+    return IO<MysqlSessionState>::fail(cancelled_error_value());
+  }
+
+  // The pool new work goes to; follows MysqlPoolWrapper::reload().
+  MysqlPoolWrapper& pool() const { return pool_.current(); }
+  std::shared_ptr<MysqlPoolWrapper> pinned_pool() const {
+    return pool_.pin_current();
+  }
+
+  bool write_pending() const {
+    std::lock_guard<std::mutex> lock(gtid_mutex_);
+    return gtid_unknown_ || !last_gtid_set_.empty();
+  }
+
+  struct HedgeRace {
+    std::function<void(IO<MysqlSessionState>::IOResult)> cb;
+    std::mutex mu;
+    bool done{false};
+    int in_flight{0};
+    std::array<MysqlPoolWrapper*, 2> pools{};
+    std::array<std::shared_ptr<asio::cancellation_signal>, 2> cancel{
+        std::make_shared<asio::cancellation_signal>(),
+        std::make_shared<asio::cancellation_signal>()};
+    std::shared_ptr<asio::steady_timer> timer;
+  };
+
+  // Hedged replica read (only for idempotent reads without a pending
+  // read-your-writes GTID): start on one replica and, if it has not answered
+  // after that replica's recent p95 execution latency, send the same read to
+  // a second replica as long as the hedge budget allows. The first
+  // successful answer wins; the loser's statement gets a terminal
+  // cancellation, which makes the pool discard and reconnect its connection.
+  IO<MysqlSessionState> run_hedged(const std::string& sql,
+                                   const QueryOptions& opts) {
+    auto* first = &pool().pick_replica();
+    auto hedge_at = sql::hedge_delay(
+        first->metrics().exec_latency,
+        std::chrono::milliseconds(pool().config().hedge_min_delay_ms));
+    if (!hedge_at) return run_on_pool(*first, sql, opts);
+    auto delay = *hedge_at;
+    auto* second = &pool().pick_replica_except(first);
+    return IO<MysqlSessionState>([self = shared_from_this(), sql, opts, first,
+                                  second, delay](auto cb) {
+      auto race = std::make_shared<HedgeRace>();
+      race->cb = std::move(cb);
+      race->pools = {first, second};
+      race->in_flight = 1;
+      race->timer =
+          std::make_shared<asio::steady_timer>(first->get().get_executor());
+      race->timer->expires_after(delay);
+      race->timer->async_wait(
+          [self, race, sql, opts](const boost::system::error_code& ec) {
+            if (ec) return;
+            {
+              std::lock_guard<std::mutex> lock(race->mu);
+              if (race->done || !self->pool().try_consume_hedge_budget()) {
+                return;
+              }
+              ++race->in_flight;
+            }
+            self->hedge_attempt(race, 1, sql, opts);
+          });
+      self->hedge_attempt(race, 0, sql, opts);
+    });
+  }
+
+  void hedge_attempt(std::shared_ptr<HedgeRace> race, std::size_t idx,
+                     const std::string& sql, const QueryOptions& opts) {
+    auto* pool = race->pools[idx];
+    acquire(*pool, opts)
+        .then([self = shared_from_this(), race, idx, sql, opts,
+               pool](MysqlSessionState state) {
+          {
+            std::lock_guard<std::mutex> lock(race->mu);
+            if (race->done && state.conn.valid()) {
+              // Lost before it started: hand the connection straight back.
+              pool->dec_active();
+              state.conn = MysqlSessionState::TrackedPooledConn();
+            }
+          }
+          if (state.has_error() || !state.conn.valid()) {
+            return IO<MysqlSessionState>::pure(std::move(state));
+          }
+          return self->execute_bounded(*pool, std::move(state), sql, opts,
+                                       race->cancel[idx]);
+        })
+        .run([self = shared_from_this(), race, idx](auto r) {
+          {
+            std::lock_guard<std::mutex> lock(race->mu);
+            if (race->done) return;  // loser: state and connection drop here
+            --race->in_flight;
+            bool failed = r.is_err() || r.value().has_error();
+            if (failed && race->in_flight > 0) return;  // other may succeed
+            race->done = true;
+          }
+          race->timer->cancel();
+          auto other = 1 - idx;
+          if (auto* loser = race->pools[other]) {
+            asio::dispatch(loser->get().get_executor(),
+                           [signal = race->cancel[other]] {
+                             signal->emit(asio::cancellation_type::terminal);
+                           });
+          }
+          if (idx == 1) {
+            self->pool().metrics().hedges_won.fetch_add(
+                1, std::memory_order_relaxed);
+          }
+          race->cb(std::move(r));
+        });
+  }
+
+  // Blocks (server side) until the replica has applied `gtid` or the
+  // configured bound expires. On timeout/failure the connection is released
+  // and the returned state carries no connection.
+  IO<MysqlSessionState> wait_for_gtid(MysqlPoolWrapper& replica,
+                                      MysqlSessionState state,
+                                      const std::string& gtid) {
+    auto state_ptr = std::make_shared<MysqlSessionState>(std::move(state));
+    auto wait_ms = pool().config().gtid_wait_timeout_ms;
+    std::string wait_sql = std::format(
+        "SELECT WAIT_FOR_EXECUTED_GTID_SET('{}', {}.{:03})", gtid,
+        wait_ms / 1000, wait_ms % 1000);
+    return IO<MysqlSessionState>([state_ptr, wait_sql = std::move(wait_sql),
+                                  pool = &replica](auto cb) {
+      if (!state_ptr->conn.begin_use()) {
+        // Lease reclaimed by the pool; the caller falls back to the primary.
+        cb(IO<MysqlSessionState>::IOResult::Ok(std::move(*state_ptr)));
+        return;
+      }
+      auto results = std::make_shared<mysql::results>();
+      auto diag = std::make_shared<mysql::diagnostics>();
+      state_ptr->conn.get()->async_execute(
+          wait_sql, *results, *diag,
+          [cb = std::move(cb), state_ptr, pool, results,
+           diag](mysql::error_code ec) mutable {
+            state_ptr->conn.end_use();
+            bool caught_up = !ec && !results->rows().empty() &&
+                             !results->rows().at(0).at(0).is_null() &&
+                             results->rows().at(0).at(0).as_int64() == 0;
+            if (ec) state_ptr->conn.needs_reset = true;
+            if (!caught_up) {
+              DEBUG_PRINT("[MonadicMysqlSession] replica lagging, falling "
+                          "back to primary ec="
+                          << ec.message());
+              pool->dec_active();
+              state_ptr->conn = MysqlSessionState::TrackedPooledConn();
+            }
+            cb(IO<MysqlSessionState>::IOResult::Ok(std::move(*state_ptr)));
+          });
+    });
+  }
+
+  // After a successful non-read statement on the primary, remember the
+  // primary's executed GTID set so later replica reads can wait for it.
+  // boost::mysql does not surface session-state tracking from the OK packet,
+  // so the set is read back with one query on the same connection. Using
+  // @@GLOBAL.gtid_executed means waiting for every write the primary had
+  // applied by then, this session's among them; a superset is safe, only
+  // slower when replicas lag. While the session is pinned to the primary
+  // (see remember_gtid()) reads capture too, so the pin ends with the next
+  // statement that reaches the primary.
+  IO<MysqlSessionState> capture_gtid(MysqlSessionState state,
+                                     const std::string& sql) {
+    if (!pool().has_replicas() || state.has_error() || !state.conn.valid()) {
+      return IO<MysqlSessionState>::pure(std::move(state));
+    }
+    if (sql::is_read_only_statement(sql)) {
+      std::lock_guard<std::mutex> lock(gtid_mutex_);
+      if (!gtid_unknown_) return IO<MysqlSessionState>::pure(std::move(state));
+    }
+    auto state_ptr = std::make_shared<MysqlSessionState>(std::move(state));
+    return IO<MysqlSessionState>([state_ptr,
+                                  self = shared_from_this()](auto cb) {
+      if (!state_ptr->conn.begin_use()) {
+        self->remember_gtid(std::nullopt);
+        cb(IO<MysqlSessionState>::IOResult::Ok(std::move(*state_ptr)));
+        return;
+      }
+      auto results = std::make_shared<mysql::results>();
+      auto diag = std::make_shared<mysql::diagnostics>();
+      state_ptr->conn.get()->async_execute(
+          "SELECT @@GLOBAL.gtid_executed", *results, *diag,
+          [cb = std::move(cb), state_ptr, self, results,
+           diag](mysql::error_code ec) mutable {
+            state_ptr->conn.end_use();
+            if (ec) state_ptr->conn.needs_reset = true;
+            std::string gtid;
+            if (!ec && !results->rows().empty() &&
+                results->rows().at(0).at(0).is_string()) {
+              gtid = results->rows().at(0).at(0).as_string();
+            }
+            self->remember_gtid(ec ? std::nullopt
+                                   : std::make_optional(std::move(gtid)));
+            cb(IO<MysqlSessionState>::IOResult::Ok(std::move(*state_ptr)));
+          });
+    });
+  }
+
+  // nullopt means the write's GTID could not be determined; replica reads
+  // are then pinned to the primary until a later capture succeeds. The
+  // primary's gtid_executed only grows, so that capture also covers the
+  // write whose GTID was lost.
+  void remember_gtid(std::optional<std::string> gtid) {
+    std::lock_guard<std::mutex> lock(gtid_mutex_);
+    if (!gtid || !is_safe_gtid_set(*gtid)) {
+      gtid_unknown_ = true;
+      return;
+    }
+    gtid_unknown_ = false;
+    if (!gtid->empty()) last_gtid_set_ = std::move(*gtid);
+  }
+
+  // GTID sets are uuid:interval lists; anything else is refused before it
+  // gets interpolated into WAIT_FOR_EXECUTED_GTID_SET.
+  static bool is_safe_gtid_set(const std::string& gtid) {
+    return std::all_of(gtid.begin(), gtid.end(), [](unsigned char c) {
+      return std::isxdigit(c) || c == ':' || c == '-' || c == ',' ||
+             std::isspace(c);
+    });
+  }
+
   IO<MysqlSessionState> get_connection(std::chrono::seconds timeout) {
-    return IO<MysqlSessionState>([self = shared_from_this(), timeout](auto cb) {
+    return get_connection(pool(), timeout);
+  }
+
+  IO<MysqlSessionState> get_connection(
+      MysqlPoolWrapper& target, std::chrono::steady_clock::duration timeout,
+      sql::Priority priority = sql::Priority::Normal,
+      std::shared_ptr<sql::CancelToken> cancel = nullptr,
+      std::string lease_tag = {}, uint64_t qid = 0) {
+    return IO<MysqlSessionState>([self = shared_from_this(), pool = &target,
+                                  timeout, priority, cancel,
+                                  lease_tag = std::move(lease_tag),
+                                  qid](auto cb) {
 #ifdef BB_MYSQL_VERBOSE
       std::cerr << "[instrument] get_connection IO thunk start timeout="
-                << timeout.count() << "s" << std::endl;
+                << std::chrono::duration_cast<std::chrono::milliseconds>(
+                       timeout)
+                       .count()
+                << "ms" << std::endl;
 #endif
+      if (pool->draining()) {
+        cb(IO<MysqlSessionState>::IOResult::Err(
+            Error{db_errors::POOL::DRAINING,
+                  "MySQL pool is draining; request rejected"}));
+        return;
+      }
+      // Admission control: fail fast instead of queueing for the full
+      // timeout when the pool is overloaded or its circuit is open.
+      auto admission = pool->admission().try_admit();
+      if (admission != sql::Admission::Admitted) {
+        bool overloaded = admission == sql::Admission::Overloaded;
+        (overloaded ? pool->metrics().rejected_overload
+                    : pool->metrics().rejected_circuit_open)
+            .fetch_add(1, std::memory_order_relaxed);
+        cb(IO<MysqlSessionState>::IOResult::Err(
+            overloaded ? Error{db_errors::POOL::OVERLOADED,
+                               "MySQL pool overloaded; request rejected"}
+                       : Error{db_errors::POOL::CIRCUIT_OPEN,
+                               "MySQL pool circuit breaker open; request "
+                               "rejected"}));
+        return;
+      }
+      auto admitted_at = std::chrono::steady_clock::now();
       // watchdog instrumentation to detect stall obtaining connection
       auto done_flag = std::make_shared<std::atomic<bool>>(false);
       auto start_tp = std::make_shared<std::chrono::steady_clock::time_point>(
           std::chrono::steady_clock::now());
-      auto watchdog_timer = std::make_shared<asio::steady_timer>(
-          self->pool_.get().get_executor());
+      auto watchdog_timer =
+          std::make_shared<asio::steady_timer>(pool->get().get_executor());
       auto arm_watchdog = std::make_shared<std::function<void(int)>>();
       std::weak_ptr<std::function<void(int)>> weak_watchdog = arm_watchdog;
       *arm_watchdog = [watchdog_timer, done_flag, start_tp,
@@ -165,17 +1084,48 @@ class MonadicMysqlSession
       (*arm_watchdog)(1);
       // Manual timeout implementation (no cancel_after) now that root stall is
       // resolved.
-      auto timeout_timer = std::make_shared<asio::steady_timer>(
-          self->pool_.get().get_executor());
+      auto timeout_timer =
+          std::make_shared<asio::steady_timer>(pool->get().get_executor());
+      // Caller cancellation while queued at the gate or waiting on the pool.
+      // Timeouts and cancellation also abort the pending
+      // async_get_connection through acquire_cancel, so its permit comes
+      // back now rather than whenever a connection frees up.
+      auto acquire_cancel = std::make_shared<asio::cancellation_signal>();
+      auto subscription = std::make_shared<std::atomic<uint64_t>>(0);
+      auto unsubscribe = [cancel, subscription] {
+        if (cancel) cancel->unsubscribe(subscription->load());
+      };
+      if (cancel) {
+        subscription->store(cancel->subscribe([done_flag, cb, pool,
+                                               timeout_timer, watchdog_timer,
+                                               acquire_cancel]() mutable {
+          asio::dispatch(pool->get().get_executor(), [=]() mutable {
+            if (done_flag->exchange(true)) return;
+            timeout_timer->cancel();
+            watchdog_timer->cancel();
+            acquire_cancel->emit(asio::cancellation_type::terminal);
+            pool->admission().on_abandoned();
+            pool->metrics().queries_cancelled.fetch_add(
+                1, std::memory_order_relaxed);
+            cb(IO<MysqlSessionState>::IOResult::Err(cancelled_error_value()));
+          });
+        }));
+      }
       timeout_timer->expires_after(timeout);
       timeout_timer->async_wait(
-          [done_flag, cb, self, timeout_timer,
-           watchdog_timer](const boost::system::error_code& ec) mutable {
+          [done_flag, cb, self, pool, timeout_timer, watchdog_timer,
+           unsubscribe,
+           acquire_cancel](const boost::system::error_code& ec) mutable {
             if (done_flag->load()) return;  // already completed
             if (ec) return;                 // cancelled
             BOOST_LOG_SEV(self->lg, trivial::error)
                 << "[MonadicMysqlSession] get_connection exceeded timeout";
             done_flag->store(true);
+            unsubscribe();
+            acquire_cancel->emit(asio::cancellation_type::terminal);
+            self->note_acquire_failure(*pool);
+            // A saturated pool times out too; pacing only hears about it
+            // when the aborted acquisition reports a connect error.
             // Cancel watchdog timer to prevent leak
             watchdog_timer->cancel();
             MysqlSessionState state;
@@ -183,74 +1133,280 @@ class MonadicMysqlSession
             cb(IO<MysqlSessionState>::IOResult::Ok(std::move(state)));
           });
 
+      // Connections are handed out through the pool's priority gate: `start`
+      // runs once this caller holds a permit, immediately unless the pool is
+      // saturated. The permit travels with the connection and is returned
+      // when the TrackedPooledConn releases it.
+      auto start = [self, pool, cb = std::move(cb), done_flag,
+                    timeout_timer, watchdog_timer, admitted_at, unsubscribe,
+                    acquire_cancel, lease_tag, qid]() mutable {
+        if (done_flag->load()) {
+          // Timed out while queued at the gate; pass the permit on.
+          pool->release_permit();
+          return;
+        }
 #ifdef BB_MYSQL_VERBOSE
-      std::cerr
-          << "[instrument] async_get_connection launching (no artificial delay)"
-          << std::endl;
+        std::cerr << "[instrument] async_get_connection launching (no "
+                     "artificial delay)"
+                  << std::endl;
 #endif
-      self->pool_.get().async_get_connection(
-          [self, cb = std::move(cb), done_flag, timeout_timer,
-           watchdog_timer](boost::system::error_code ec,
-                            mysql::pooled_connection conn) mutable {
-            if (done_flag->load()) {
-              // raced with timeout; release connection immediately if obtained
-              if (!ec && conn.valid()) {
+        pool->get().async_get_connection(asio::bind_cancellation_slot(
+            acquire_cancel->slot(),
+            [self, pool, cb = std::move(cb), done_flag, timeout_timer,
+             watchdog_timer, admitted_at, unsubscribe, acquire_cancel,
+             lease_tag, qid](boost::system::error_code ec,
+                             mysql::pooled_connection conn) mutable {
+              if (done_flag->load()) {
+                // Timed out or cancelled (usually aborted through
+                // acquire_cancel); a connection that raced in goes back to
+                // the pool when `conn` leaves scope. The pool reports why
+                // it had none: its last connect error, if any.
+                if (sql::is_connect_error(ec)) pool->on_connect_failure();
+                if (!ec && conn.valid()) {
 #ifdef BB_MYSQL_VERBOSE
-                std::cerr << "[instrument][race] connection arrived after "
-                             "timeout; releasing"
-                          << std::endl;
+                  std::cerr << "[instrument][race] connection arrived after "
+                               "timeout; releasing"
+                            << std::endl;
 #endif
+                }
+                pool->release_permit();
+                return;  // timeout already delivered
               }
-              return;  // timeout already delivered
-            }
 #ifdef BB_MYSQL_VERBOSE
-            std::cerr
-                << "[instrument] get_connection completion handler invoked ec="
-                << (ec ? ec.message() : "OK") << " (immediate path)"
-                << std::endl;
+              std::cerr << "[instrument] get_connection completion handler "
+                           "invoked ec="
+                        << (ec ? ec.message() : "OK") << " (immediate path)"
+                        << std::endl;
 #endif
-            done_flag->store(true);
-            timeout_timer->cancel();
-            // Cancel watchdog timer to prevent leak
-            watchdog_timer->cancel();
-            MysqlSessionState state;
-            if (ec) {
-              state.error = ec;
-            } else {
-              state.conn =
-                  MysqlSessionState::TrackedPooledConn(std::move(conn));
-              self->pool_.inc_active();
+              done_flag->store(true);
+              unsubscribe();
+              timeout_timer->cancel();
+              // Cancel watchdog timer to prevent leak
+              watchdog_timer->cancel();
+              MysqlSessionState state;
+              if (ec) {
+                state.error = ec;
+                self->note_acquire_failure(*pool);
+                if (sql::is_connect_error(ec)) pool->on_connect_failure();
+                pool->release_permit();
+              } else {
+                pool->admission().on_acquired();
+                pool->metrics().acquire_wait.record(
+                    std::chrono::steady_clock::now() - admitted_at);
+                state.conn = MysqlSessionState::TrackedPooledConn(
+                    std::move(conn), pool, pool->open_lease(lease_tag, qid));
+                state.conn.admitted_at = admitted_at;
+                pool->inc_active();
+              }
+              if (state.has_error() || !state.conn.valid()) {
+                cb(IO<MysqlSessionState>::IOResult::Ok(std::move(state)));
+                return;
+              }
+
+              // Ensure all session-level time computations behave as UTC
+              // (see sql::kSessionSetupSql).
+              auto tz_results = std::make_shared<mysql::results>();
+              auto tz_diag = std::make_shared<mysql::diagnostics>();
+              state.conn.begin_use();
+              state.conn.get()->async_execute(
+                  sql::kSessionSetupSql, *tz_results, *tz_diag,
+                  [pool, cb = std::move(cb), state = std::move(state),
+                   tz_results, tz_diag](mysql::error_code tz_ec) mutable {
+                    state.conn.end_use();
+                    if (!tz_ec) {
+                      // Only the (idempotent) setup ran so far; see
+                      // TrackedPooledConn::needs_reset.
+                      state.conn.needs_reset = false;
+                      pool->on_connect_success();
+                    } else {
+                      // The connection broke before serving anything.
+                      pool->on_connect_failure();
+                      state.error = tz_ec;
+                      state.diag = *tz_diag;
+                      // get_connection() increments active; release on
+                      // error.
+                      if (state.conn.valid()) {
+                        pool->dec_active();
+                      }
+                    }
+                    cb(IO<MysqlSessionState>::IOResult::Ok(std::move(state)));
+                  });
+            }));
+      };
+      pool->acquire_permit(priority, std::move(start));
+    });
+  }
+
+  // execute_sql() under opts.exec_timeout, shortened to what is left of
+  // opts.deadline, and abortable through opts.cancel (plain execute_sql()
+  // without any of them).
+  IO<MysqlSessionState> execute_bounded(
+      MysqlPoolWrapper& target, MysqlSessionState state, const std::string& sql,
+      const QueryOptions& opts,
+      std::shared_ptr<asio::cancellation_signal> cancel = nullptr) {
+    if (!state.conn.valid()) {
+      return execute_sql(target, std::move(state), sql, std::move(cancel),
+                         opts.tag);
+    }
+    auto bound = opts.exec_timeout;
+    bool by_deadline = false;
+    if (opts.deadline) {
+      auto left = std::chrono::duration_cast<std::chrono::milliseconds>(
+          *opts.deadline - std::chrono::steady_clock::now());
+      if (left <= std::chrono::milliseconds(0)) {
+        // Spent while acquiring: give the connection back unused.
+        target.dec_active();
+        return deadline_exceeded();
+      }
+      if (!bound || left < *bound) {
+        bound = left;
+        by_deadline = true;
+      }
+    }
+    const auto& token = opts.cancel;
+    if (token && token->cancelled()) {
+      target.dec_active();
+      target.metrics().queries_cancelled.fetch_add(1,
+                                                   std::memory_order_relaxed);
+      return cancelled_error();
+    }
+    if (!bound && !token) {
+      return execute_sql(target, std::move(state), sql, std::move(cancel),
+                         opts.tag);
+    }
+    std::string text = sql;
+    std::optional<std::chrono::steady_clock::duration> client_limit;
+    std::optional<std::chrono::steady_clock::duration> server_limit;
+    if (bound) {
+      text = sql::with_max_execution_time(
+          sql, static_cast<uint64_t>(std::max<int64_t>(bound->count(), 1)));
+      if (text.size() != sql.size()) server_limit = *bound;
+      // Give the server-side limit a head start: aborting through the hint
+      // keeps the connection usable.
+      client_limit = server_limit ? *bound + std::chrono::milliseconds(50)
+                                  : *bound;
+    }
+    if (!cancel) cancel = std::make_shared<asio::cancellation_signal>();
+    auto conn_id = state.conn.get()->connection_id();
+    auto state_ptr = std::make_shared<MysqlSessionState>(std::move(state));
+    return IO<MysqlSessionState>([self = shared_from_this(), pool = &target,
+                                  state_ptr, text = std::move(text), cancel,
+                                  conn_id, client_limit, server_limit,
+                                  by_deadline, token,
+                                  tag = opts.tag](auto cb) {
+      auto expired = std::make_shared<std::atomic<bool>>(false);
+      auto started = std::chrono::steady_clock::now();
+      std::shared_ptr<asio::steady_timer> timer;
+      if (client_limit) {
+        timer =
+            std::make_shared<asio::steady_timer>(pool->get().get_executor());
+        timer->expires_after(*client_limit);
+        timer->async_wait([self, pool, expired, cancel,
+                           conn_id](const boost::system::error_code& ec) {
+          if (ec) return;
+          expired->store(true);
+          if (conn_id) {
+            self->kill_query(*pool, *conn_id, "execution deadline exceeded");
+          }
+          // Stop waiting right away; the connection becomes unusable and
+          // the pool replaces it when it is returned.
+          cancel->emit(asio::cancellation_type::terminal);
+        });
+      }
+      uint64_t subscription = 0;
+      if (token) {
+        // Same abort as an expiry. Closing the connection alone does not
+        // stop the server: it runs the statement to completion unless it
+        // is killed.
+        subscription = token->subscribe([self, pool, cancel, conn_id] {
+          asio::dispatch(pool->get().get_executor(), [self, pool, cancel,
+                                                      conn_id] {
+            if (conn_id) self->kill_query(*pool, *conn_id, "cancelled");
+            cancel->emit(asio::cancellation_type::terminal);
+          });
+        });
+      }
+      self->execute_sql(*pool, std::move(*state_ptr), text, cancel, tag)
+          .run([cb = std::move(cb), timer, expired, pool, by_deadline, token,
+                subscription, server_limit, started](auto r) mutable {
+            if (timer) timer->cancel();
+            if (token) token->unsubscribe(subscription);
+            bool server_timeout =
+                r.is_ok() &&
+                r.value().error.value() == kServerQueryTimeout &&
+                r.value().error.category() ==
+                    mysql::get_mysql_server_category();
+            // MAX_EXECUTION_TIME does not fail a statement that only
+            // sleeps: SELECT SLEEP(n) is cut short and returns 1 without
+            // an error. A success only arriving after the hinted limit is
+            // an overrun all the same.
+            if (server_limit && r.is_ok() && !r.value().has_error() &&
+                std::chrono::steady_clock::now() - started >= *server_limit) {
+              server_timeout = true;
             }
-            if (state.has_error() || !state.conn.valid()) {
-              cb(IO<MysqlSessionState>::IOResult::Ok(std::move(state)));
+            if (expired->load() || server_timeout) {
+              pool->metrics().query_timeouts.fetch_add(
+                  1, std::memory_order_relaxed);
+              cb(IO<MysqlSessionState>::IOResult::Err(
+                  by_deadline
+                      ? Error{db_errors::SQL_EXEC::DEADLINE_EXCEEDED,
+                              "MySQL request deadline exceeded"}
+                      : Error{db_errors::SQL_EXEC::QUERY_TIMEOUT,
+                              "MySQL query exceeded its execution deadline"}));
               return;
             }
-
-            // Ensure all session-level time computations (NOW(), CURRENT_TIMESTAMP,
-            // date casts, etc.) behave as UTC. This avoids implicit dependence on
-            // MySQL server/session timezone.
-            auto tz_results = std::make_shared<mysql::results>();
-            auto tz_diag = std::make_shared<mysql::diagnostics>();
-            state.conn.get()->async_execute(
-                "SET time_zone = '+00:00'", *tz_results, *tz_diag,
-                [self, cb = std::move(cb), state = std::move(state), tz_results,
-                 tz_diag](mysql::error_code tz_ec) mutable {
-                  if (tz_ec) {
-                    state.error = tz_ec;
-                    state.diag = *tz_diag;
-                    // get_connection() increments active; release on error.
-                    if (state.conn.valid()) {
-                      self->pool_.dec_active();
-                    }
-                  }
-                  cb(IO<MysqlSessionState>::IOResult::Ok(std::move(state)));
-                });
+            bool failed = r.is_err() || r.value().has_error();
+            if (failed && token && token->cancelled()) {
+              // The aborted connection was discarded with the state; the
+              // pool reconnects it.
+              pool->metrics().queries_cancelled.fetch_add(
+                  1, std::memory_order_relaxed);
+              cb(IO<MysqlSessionState>::IOResult::Err(cancelled_error_value()));
+              return;
+            }
+            cb(std::move(r));
           });
     });
   }
 
+  // ER_QUERY_TIMEOUT: statement aborted by MAX_EXECUTION_TIME.
+  static constexpr int kServerQueryTimeout = 3024;
+
+  void kill_query(MysqlPoolWrapper& pool, std::uint32_t connection_id,
+                  const char* reason) {
+    BOOST_LOG_SEV(lg, trivial::warning)
+        << "[MonadicMysqlSession] " << reason << "; KILL QUERY "
+        << connection_id;
+    pool.kill_query(connection_id);
+  }
+
+  // An admitted acquisition timed out or failed: frees its admission slot and
+  // feeds the circuit breaker.
+  void note_acquire_failure(MysqlPoolWrapper& pool) {
+    if (pool.admission().on_failure()) {
+      pool.metrics().breaker_trips.fetch_add(1, std::memory_order_relaxed);
+      BOOST_LOG_SEV(lg, trivial::warning)
+          << "[MonadicMysqlSession] circuit breaker opened for "
+          << pool.config().host << ":" << pool.config().port;
+    }
+  }
+
   IO<MysqlSessionState> execute_sql(MysqlSessionState state,
                                     const std::string& sql) {
+    return execute_sql(pool(), std::move(state), sql);
+  }
+
+  // `cancel` is bound as the cancellation slot of async_execute (one is
+  // created when not given, so MysqlPoolWrapper::drain() can abort the
+  // statement). Emitting a terminal cancellation aborts the statement and
+  // leaves the connection unusable, so the pool reconnects it on return.
+  // `tag` names the completion for the IO lag monitor.
+  IO<MysqlSessionState> execute_sql(
+      MysqlPoolWrapper& target, MysqlSessionState state, const std::string& sql,
+      std::shared_ptr<asio::cancellation_signal> cancel = nullptr,
+      std::string tag = {}) {
+    if (!cancel) cancel = std::make_shared<asio::cancellation_signal>();
+    if (tag.empty()) tag = "execute_sql";
     auto state_ptr = std::make_shared<MysqlSessionState>(std::move(state));
 #ifdef BB_MYSQL_VERBOSE
     const void* raw_conn_ptr =
@@ -262,7 +1418,8 @@ class MonadicMysqlSession
               << " state_ptr.use_count=" << state_ptr.use_count() << std::endl;
     auto preview = sql.substr(0, 100);
 #endif
-    return IO<MysqlSessionState>([state_ptr, sql,
+    return IO<MysqlSessionState>([state_ptr, sql, pool = &target, cancel,
+                                  tag = std::move(tag),
                                   self = shared_from_this()](auto cb) {
 #ifdef BB_MYSQL_VERBOSE
       const void* raw_conn_ptr_inner =
@@ -274,10 +1431,37 @@ class MonadicMysqlSession
                 << " state_ptr.use_count=" << state_ptr.use_count()
                 << std::endl;
 #endif
-      state_ptr->conn.get()->async_execute(
-          sql, state_ptr->results, state_ptr->diag,
-          [cb = std::move(cb), state_ptr, self](mysql::error_code ec) mutable {
-      state_ptr->error = ec;
+      if (!state_ptr->conn.begin_use()) {
+        // Held past lease_reclaim_ms and taken back by the pool.
+        cb(IO<MysqlSessionState>::IOResult::Err(
+            Error{db_errors::POOL::LEASE_RECLAIMED,
+                  "MySQL connection lease was reclaimed by the pool"}));
+        return;
+      }
+      auto started = std::chrono::steady_clock::now();
+      bool stateless = sql::is_session_stateless(sql);
+      auto running = pool->track_statement(
+          state_ptr->conn.get()->connection_id(), cancel);
+      auto on_done = [cb = std::move(cb), state_ptr, pool, started, stateless,
+                      self, running, tag](mysql::error_code ec) mutable {
+            state_ptr->conn.end_use();
+            pool->untrack_statement(running);
+            state_ptr->error = ec;
+            if (ec || !stateless) state_ptr->conn.needs_reset = true;
+            auto finished = std::chrono::steady_clock::now();
+            pool->metrics().exec_latency.record(finished - started);
+            if (auto* owner = state_ptr->conn.permit_owner) {
+              // Acquire+execute for the lease's first statement, execution
+              // only for the ones after it (see admitted_at).
+              auto admitted_at = std::exchange(state_ptr->conn.admitted_at,
+                                               decltype(started){});
+              if (!ec) {
+                owner->admission().record(
+                    finished - (admitted_at == decltype(started){}
+                                    ? started
+                                    : admitted_at));
+              }
+            }
 #ifdef BB_MYSQL_VERBOSE
             const void* raw_conn_ptr_done =
                 state_ptr->conn.valid()
@@ -307,11 +1491,17 @@ class MonadicMysqlSession
             }
 #endif
             if (state_ptr->conn.valid()) {
-              self->pool_.dec_active();
+              pool->dec_active();
             }
+            // The caller's continuations run inline from here unless
+            // delivered elsewhere (QueryOptions::completion_executor).
+            sql::IoLagTracker::Scope scope(self->pool_.lag_tracker(), tag);
             cb(IO<MysqlSessionState>::IOResult::Ok(
                 std::move(*state_ptr)));  // move the object back out
-          });
+          };
+      state_ptr->conn.get()->async_execute(
+          sql, state_ptr->results, state_ptr->diag,
+          asio::bind_cancellation_slot(cancel->slot(), std::move(on_done)));
     });
   }
 };
@@ -0,0 +1,98 @@
+#pragma once
+
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace sql {
+
+// PoolRegistry
+// --------------------------------------------------------------------
+// Named pools created on first use. The set of names is fixed when the
+// registry is built (from config), so find() walks an immutable table and,
+// once a pool exists, returns it with a single acquire load; only the first
+// caller of each name takes the creation lock. Unknown names yield nullptr.
+//
+// `Config` must expose a `name` member; `Pool` is built by the factory
+// given to find(), which lets the owner decide which io_context (and thus
+// which IO thread) the pool runs on. Pools live as long as the registry.
+template <class Config, class Pool>
+class PoolRegistry {
+ public:
+  PoolRegistry() = default;
+  explicit PoolRegistry(const std::vector<Config>& configs) {
+    slots_.reserve(configs.size());
+    for (const auto& config : configs) {
+      slots_.emplace_back(new Slot{config, {nullptr}, nullptr});
+    }
+  }
+
+  PoolRegistry(const PoolRegistry&) = delete;
+  PoolRegistry& operator=(const PoolRegistry&) = delete;
+
+  template <class Make>
+  Pool* find(std::string_view name, Make&& make) {
+    auto* slot = lookup(name);
+    if (!slot) return nullptr;
+    if (auto* p = slot->pool.load(std::memory_order_acquire)) return p;
+    std::lock_guard<std::mutex> lock(create_mutex_);
+    auto* p = slot->pool.load(std::memory_order_relaxed);
+    if (!p) {
+      slot->owned = make(slot->config);
+      p = slot->owned.get();
+      slot->pool.store(p, std::memory_order_release);
+    }
+    return p;
+  }
+
+  bool contains(std::string_view name) const {
+    return lookup(name) != nullptr;
+  }
+
+  std::vector<std::string> names() const {
+    std::vector<std::string> out;
+    out.reserve(slots_.size());
+    for (const auto& slot : slots_) out.push_back(slot->config.name);
+    return out;
+  }
+
+  // Pools created so far.
+  std::size_t created() const {
+    std::lock_guard<std::mutex> lock(create_mutex_);
+    std::size_t n = 0;
+    for (const auto& slot : slots_) n += slot->owned ? 1 : 0;
+    return n;
+  }
+
+  // Visits the pools created so far, under the creation lock.
+  template <class F>
+  void for_each(F&& f) {
+    std::lock_guard<std::mutex> lock(create_mutex_);
+    for (auto& slot : slots_) {
+      if (slot->owned) f(*slot->owned);
+    }
+  }
+
+ private:
+  struct Slot {
+    Config config;
+    std::atomic<Pool*> pool;
+    std::unique_ptr<Pool> owned;
+  };
+
+  Slot* lookup(std::string_view name) const {
+    for (const auto& slot : slots_) {
+      if (slot->config.name == name) return slot.get();
+    }
+    return nullptr;
+  }
+
+  std::vector<std::unique_ptr<Slot>> slots_;
+  mutable std::mutex create_mutex_;
+};
+
+}  // namespace sql
@@ -0,0 +1,76 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+
+namespace sql {
+
+struct PoolSizerOptions {
+  std::size_t floor{1};
+  std::size_t ceiling{151};
+  // Acquire-wait p95 above which the limit is raised.
+  std::chrono::microseconds target_wait{std::chrono::milliseconds(20)};
+  // Upper bound of the raise per evaluation (growth rate limit).
+  std::size_t grow_step{4};
+  // Quiet period after any change before the limit may be lowered again.
+  std::chrono::milliseconds cooldown{std::chrono::seconds(30)};
+};
+
+enum class ResizeAction { None, Raise, Lower };
+
+struct ResizeDecision {
+  ResizeAction action{ResizeAction::None};
+  std::size_t from{0};
+  std::size_t to{0};
+  std::chrono::microseconds wait_p95{0};
+};
+
+// PoolSizer
+// --------------------------------------------------------------------
+// Decides how many connections may be in use at once (the concurrency
+// limit) from acquire-wait telemetry. It is evaluated periodically with
+// the wait p95 observed since the previous evaluation:
+//  - p95 above target: raise by at most grow_step, up to ceiling.
+//  - p95 at most half the target (or no traffic) and no change for
+//    `cooldown`: drop half of the idle headroom, never below floor or the
+//    connections currently in use.
+// The half-target dead band keeps the limit from oscillating around the
+// target. Pure and single-threaded; the owner serializes evaluate().
+class PoolSizer {
+ public:
+  using Clock = std::chrono::steady_clock;
+
+  explicit PoolSizer(PoolSizerOptions opts) : opts_(opts) {}
+
+  ResizeDecision evaluate(std::size_t capacity, std::size_t in_use,
+                          std::chrono::microseconds wait_p95,
+                          Clock::time_point now) {
+    ResizeDecision d{ResizeAction::None, capacity, capacity, wait_p95};
+    if (wait_p95 > opts_.target_wait && capacity < opts_.ceiling) {
+      d.action = ResizeAction::Raise;
+      d.to = std::min(opts_.ceiling, capacity + std::max<std::size_t>(
+                                                    opts_.grow_step, 1));
+      last_resize_ = now;
+      return d;
+    }
+    bool quiet = wait_p95 * 2 <= opts_.target_wait;
+    bool cooled = last_resize_ == Clock::time_point{} ||
+                  now - last_resize_ >= opts_.cooldown;
+    std::size_t lower = std::max(opts_.floor, in_use);
+    if (quiet && cooled && capacity > lower) {
+      d.action = ResizeAction::Lower;
+      d.to = capacity - std::max<std::size_t>((capacity - lower) / 2, 1);
+      last_resize_ = now;
+    }
+    return d;
+  }
+
+  const PoolSizerOptions& options() const { return opts_; }
+
+ private:
+  PoolSizerOptions opts_;
+  Clock::time_point last_resize_{};
+};
+
+}  // namespace sql
@@ -0,0 +1,203 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <optional>
+#include <vector>
+
+#include "mysql_connect_pacer.hpp"
+
+namespace sql {
+
+// Acquisition priority. Higher values are served first when the pool is
+// saturated.
+enum class Priority : int {
+  Background = 0,
+  Batch = 1,
+  Normal = 2,
+  Interactive = 3
+};
+
+// PriorityGate
+// --------------------------------------------------------------------
+// Counting semaphore in front of connection_pool::async_get_connection.
+// The pool serves its own waiters FIFO; by holding callers here until a
+// permit is free, the next free connection goes to the most important
+// waiter instead.
+//
+// Starvation protection: a waiter's effective priority grows by one level
+// for every `aging` interval it has been queued, so background work still
+// progresses under sustained interactive load.
+//
+// Connection pacing (optional): the gate remembers the highest number of
+// permits out at once since the last connection failure. Permits beyond
+// that high-water mark make the pool open a new connection, so each needs a
+// ConnectPacer token; waiters stay queued until one is available (see
+// pacing_wakeup()).
+//
+// The gate never runs grants itself. acquire() reports whether the permit
+// was taken immediately; release() hands the permit directly to the chosen
+// waiter and returns its grant for the caller to dispatch (typically posted
+// to the pool executor so it never runs inside a destructor).
+class PriorityGate {
+ public:
+  using Clock = std::chrono::steady_clock;
+  using Grant = std::function<void()>;
+  static constexpr std::size_t kLevels = 4;
+
+  PriorityGate(std::size_t capacity, std::chrono::milliseconds aging)
+      : capacity_(capacity), aging_(aging) {}
+
+  // Takes a permit and returns true (grant is left untouched so the caller
+  // can run it), or queues `grant` and returns false.
+  bool acquire(Priority priority, Grant&& grant,
+               Clock::time_point now = Clock::now()) {
+    std::lock_guard<std::mutex> lock(mu_);
+    if (in_use_ < capacity_ && waiting_ == 0 && may_grow_locked(now)) {
+      grant_locked();
+      return true;
+    }
+    levels_[level_of(priority)].push_back(Waiter{std::move(grant), now});
+    ++waiting_;
+    return false;
+  }
+
+  // Returns a permit. If someone is waiting the permit is transferred to them
+  // and their grant is returned; otherwise the result is empty.
+  Grant release(Clock::time_point now = Clock::now()) {
+    std::lock_guard<std::mutex> lock(mu_);
+    if (in_use_ > 0) --in_use_;
+    return next_locked(now);
+  }
+
+  // Changes the number of permits. Returns grants of waiters admitted by a
+  // larger capacity.
+  std::vector<Grant> set_capacity(std::size_t capacity,
+                                  Clock::time_point now = Clock::now()) {
+    std::lock_guard<std::mutex> lock(mu_);
+    capacity_ = capacity;
+    return drain_locked(now);
+  }
+
+  // Grants every waiter that can be admitted now (after pacing tokens became
+  // available).
+  std::vector<Grant> admit_ready(Clock::time_point now = Clock::now()) {
+    std::lock_guard<std::mutex> lock(mu_);
+    return drain_locked(now);
+  }
+
+  void enable_pacing(ConnectPacerOptions opts) {
+    std::lock_guard<std::mutex> lock(mu_);
+    pacer_.emplace(opts);
+  }
+
+  // The pool could not hand out a connection: connections beyond the ones in
+  // use now may be gone, so further growth is paced again and backs off.
+  void on_connect_failure(Clock::time_point now = Clock::now()) {
+    std::lock_guard<std::mutex> lock(mu_);
+    high_water_ = in_use_;
+    if (pacer_) pacer_->on_failure(now);
+  }
+
+  void on_connect_success() {
+    std::lock_guard<std::mutex> lock(mu_);
+    if (pacer_) pacer_->on_success();
+  }
+
+  // When waiters are held back only by pacing, the time a token is due.
+  std::optional<Clock::time_point> pacing_wakeup(
+      Clock::time_point now = Clock::now()) {
+    std::lock_guard<std::mutex> lock(mu_);
+    if (!pacer_ || waiting_ == 0 || in_use_ >= capacity_ ||
+        in_use_ < high_water_) {
+      return std::nullopt;
+    }
+    return pacer_->next_token_at(now);
+  }
+
+  std::size_t capacity() const {
+    std::lock_guard<std::mutex> lock(mu_);
+    return capacity_;
+  }
+  std::size_t in_use() const {
+    std::lock_guard<std::mutex> lock(mu_);
+    return in_use_;
+  }
+  std::size_t waiting() const {
+    std::lock_guard<std::mutex> lock(mu_);
+    return waiting_;
+  }
+
+ private:
+  struct Waiter {
+    Grant grant;
+    Clock::time_point enqueued;
+  };
+
+  static std::size_t level_of(Priority p) {
+    auto v = static_cast<int>(p);
+    if (v < 0) return 0;
+    if (v >= static_cast<int>(kLevels)) return kLevels - 1;
+    return static_cast<std::size_t>(v);
+  }
+
+  // Permits below the high-water mark reuse connections the pool already
+  // has; the ones above it need a pacing token.
+  bool may_grow_locked(Clock::time_point now) {
+    return in_use_ < high_water_ || !pacer_ || pacer_->try_take(now);
+  }
+
+  void grant_locked() {
+    ++in_use_;
+    high_water_ = std::max(high_water_, in_use_);
+  }
+
+  std::vector<Grant> drain_locked(Clock::time_point now) {
+    std::vector<Grant> admitted;
+    while (auto g = next_locked(now)) admitted.push_back(std::move(g));
+    return admitted;
+  }
+
+  // Pops the waiter with the highest aged priority (oldest wins ties) if a
+  // permit is free.
+  Grant next_locked(Clock::time_point now) {
+    if (waiting_ == 0 || in_use_ >= capacity_) return {};
+    if (!may_grow_locked(now)) return {};
+    std::size_t best = kLevels;
+    long long best_score = 0;
+    for (std::size_t level = 0; level < kLevels; ++level) {
+      if (levels_[level].empty()) continue;
+      const auto& head = levels_[level].front();
+      long long aged =
+          aging_.count() > 0 ? (now - head.enqueued) / aging_ : 0;
+      long long score = static_cast<long long>(level) + aged;
+      if (best == kLevels || score > best_score ||
+          (score == best_score &&
+           head.enqueued < levels_[best].front().enqueued)) {
+        best = level;
+        best_score = score;
+      }
+    }
+    auto grant = std::move(levels_[best].front().grant);
+    levels_[best].pop_front();
+    --waiting_;
+    grant_locked();
+    return grant;
+  }
+
+  mutable std::mutex mu_;
+  std::size_t capacity_;
+  std::chrono::milliseconds aging_;
+  std::size_t in_use_{0};
+  std::size_t waiting_{0};
+  std::size_t high_water_{0};
+  std::optional<ConnectPacer> pacer_;
+  std::array<std::deque<Waiter>, kLevels> levels_;
+};
+
+}  // namespace sql
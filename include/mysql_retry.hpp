@@ -0,0 +1,121 @@
+#pragma once
+
+#include <algorithm>
+#include <boost/asio/error.hpp>
+#include <boost/mysql/client_errc.hpp>
+#include <boost/mysql/error_categories.hpp>
+#include <boost/system/error_code.hpp>
+#include <chrono>
+#include <cstdint>
+
+namespace sql {
+
+// Retry of transient failures
+// --------------------------------------------------------------------
+// What a failed statement tells about its effects decides whether running
+// it again is safe:
+//  - NotExecuted: it never reached the server (no pooled connection in
+//    time, server refused the connection). Always safe to retry.
+//  - RolledBack: the server aborted it and rolled it back (deadlock, lock
+//    wait timeout). Safe for a single autocommit statement; a
+//    multi-statement text may have applied the statements before the
+//    failing one, so it needs the caller's idempotency promise.
+//  - Ambiguous: the connection broke while it ran; it may or may not have
+//    been applied. Retried only for idempotent queries.
+//  - Permanent: anything else (syntax, constraints, timeouts, overload,
+//    cancellation, ...). Retrying would only add load.
+enum class RetryClass { Permanent, NotExecuted, RolledBack, Ambiguous };
+
+// MySQL server error numbers. Client-side codes (libmysqlclient's CR_*,
+// 2000 and up) never come from the server; see classify_client_errc().
+inline RetryClass classify_server_errno(int code) {
+  switch (code) {
+    case 1205:  // ER_LOCK_WAIT_TIMEOUT
+    case 1213:  // ER_LOCK_DEADLOCK
+      return RetryClass::RolledBack;
+    case 1040:  // ER_CON_COUNT_ERROR
+    case 1203:  // ER_TOO_MANY_USER_CONNECTIONS
+      return RetryClass::NotExecuted;
+    case 1053:  // ER_SERVER_SHUTDOWN
+    case 1927:  // ER_CONNECTION_KILLED
+      return RetryClass::Ambiguous;
+    default:
+      return RetryClass::Permanent;
+  }
+}
+
+// Errors Boost.MySQL detects on the client side. A connection that went
+// away mid-statement (libmysqlclient's CR_SERVER_GONE_ERROR /
+// CR_SERVER_LOST) shows up as a truncated or out-of-sequence message here,
+// or as a network error (see classify_failure()).
+inline RetryClass classify_client_errc(boost::mysql::client_errc code) {
+  using boost::mysql::client_errc;
+  switch (code) {
+    case client_errc::incomplete_message:
+    case client_errc::sequence_number_mismatch:
+      return RetryClass::Ambiguous;
+    case client_errc::pool_not_running:
+      return RetryClass::NotExecuted;
+    default:
+      return RetryClass::Permanent;
+  }
+}
+
+// Error code left in MysqlSessionState::error. A pool acquisition timeout
+// surfaces as asio::error::timed_out (see MonadicMysqlSession); broken
+// connections as network or client errors.
+inline RetryClass classify_failure(const boost::system::error_code& ec) {
+  namespace mysql = boost::mysql;
+  namespace error = boost::asio::error;
+  if (!ec) return RetryClass::Permanent;
+  if (ec == error::timed_out || ec == error::connection_refused) {
+    return RetryClass::NotExecuted;
+  }
+  if (ec == error::connection_reset || ec == error::connection_aborted ||
+      ec == error::broken_pipe || ec == error::eof) {
+    return RetryClass::Ambiguous;
+  }
+  if (ec.category() == mysql::get_client_category()) {
+    return classify_client_errc(static_cast<mysql::client_errc>(ec.value()));
+  }
+  if (ec.category() == mysql::get_common_server_category() ||
+      ec.category() == mysql::get_mysql_server_category()) {
+    return classify_server_errno(ec.value());
+  }
+  return RetryClass::Permanent;
+}
+
+inline bool may_retry(RetryClass c, bool idempotent, bool single_statement) {
+  switch (c) {
+    case RetryClass::NotExecuted:
+      return true;
+    case RetryClass::RolledBack:
+      return idempotent || single_statement;
+    case RetryClass::Ambiguous:
+      return idempotent;
+    default:
+      return false;
+  }
+}
+
+struct RetryPolicy {
+  // Total attempts including the first; 1 disables retries.
+  uint32_t max_attempts{1};
+  std::chrono::milliseconds base_delay{20};
+  std::chrono::milliseconds max_delay{500};
+
+  // Pause before retry number `retry` (1 for the first retry): exponential
+  // in `retry`, capped at max_delay, then jittered into its upper half by
+  // `u` in [0, 1) so colliding transactions (the usual deadlock pair) do
+  // not retry in lockstep.
+  std::chrono::milliseconds backoff(uint32_t retry, double u) const {
+    auto ceiling = base_delay;
+    for (uint32_t i = 1; i < retry && ceiling < max_delay; ++i) ceiling *= 2;
+    ceiling = std::min(ceiling, max_delay);
+    auto half = ceiling / 2;
+    return half + std::chrono::milliseconds(static_cast<int64_t>(
+                      u * static_cast<double>((ceiling - half).count())));
+  }
+};
+
+}  // namespace sql
@@ -0,0 +1,501 @@
+#pragma once
+
+#include <boost/asio.hpp>  // IWYU pragma: keep
+#include <boost/mysql.hpp>
+#include <charconv>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "db_errors.hpp"
+#include "io_monad.hpp"
+#include "mysql_monad.hpp"
+#include "result_monad.hpp"
+
+namespace monad {
+
+// Scatter-gather
+// --------------------------------------------------------------------
+// Runs the same statement on several pools (shards, partitions, ...) in
+// parallel and hands back every per-target MysqlSessionState. Merging is done
+// over the borrowed resultset views of those states: nothing is copied into
+// an intermediate table, rows are visited in place.
+//
+// Lifetime: row_views passed to merge callbacks point into the
+// ScatterResult; consume them before it is destroyed. Connections are
+// returned to their pools as soon as each target completes, so holding a
+// ScatterResult does not pin pool capacity.
+
+struct ScatterOptions {
+  // Upper bound for one target (acquire + execute). Targets exceeding it are
+  // reported in ScatterResult::timed_out and the gather completes without
+  // them. It also becomes the query's deadline (when earlier than
+  // query.deadline), so a late statement is killed on its shard rather than
+  // left running on a held connection.
+  std::chrono::milliseconds per_target_timeout{std::chrono::seconds(5)};
+  QueryOptions query{};
+};
+
+struct ScatterPart {
+  std::size_t target;       // index into the targets given to scatter_gather
+  MysqlSessionState state;  // results of that target; connection released
+};
+
+struct ScatterResult {
+  std::vector<ScatterPart> parts;
+  std::vector<std::size_t> timed_out;
+  std::vector<std::pair<std::size_t, Error>> failed;
+
+  // True when at least one target is missing from parts.
+  bool partial() const { return !timed_out.empty() || !failed.empty(); }
+};
+
+// Every shard pool of root's shard map (created on demand), in shard order.
+inline std::vector<MysqlPoolWrapper*> all_shards(MysqlPoolWrapper& root) {
+  std::vector<MysqlPoolWrapper*> targets;
+  targets.reserve(root.shard_map().size());
+  for (std::size_t i = 0; i < root.shard_map().size(); ++i) {
+    targets.push_back(&root.shard_pool(i));
+  }
+  return targets;
+}
+
+namespace detail {
+
+template <class Cb>
+struct ScatterJoin {
+  std::mutex mu;
+  ScatterResult result;
+  std::vector<bool> done;
+  std::size_t pending;
+  Cb cb;
+
+  ScatterJoin(std::size_t n, Cb c)
+      : done(n, false), pending(n), cb(std::move(c)) {}
+
+  // Records the outcome of target i exactly once; the last one completes the
+  // gather.
+  template <class F>
+  void finish(std::size_t i, F&& record) {
+    std::unique_lock<std::mutex> lock(mu);
+    if (done[i]) return;
+    done[i] = true;
+    record(result);
+    if (--pending != 0) return;
+    auto out = std::move(result);
+    lock.unlock();
+    cb(IO<ScatterResult>::IOResult::Ok(std::move(out)));
+  }
+};
+
+}  // namespace detail
+
+// Executes sql on every target concurrently. Never fails as a whole: per
+// target errors and timeouts are reported inside the ScatterResult so the
+// caller decides whether a partial answer is acceptable.
+inline IO<ScatterResult> scatter_gather(
+    std::shared_ptr<MonadicMysqlSession> session,
+    std::vector<MysqlPoolWrapper*> targets, std::string sql,
+    ScatterOptions opts = {}) {
+  return IO<ScatterResult>([session = std::move(session),
+                            targets = std::move(targets), sql = std::move(sql),
+                            opts](auto cb) {
+    if (targets.empty()) {
+      cb(IO<ScatterResult>::IOResult::Ok(ScatterResult{}));
+      return;
+    }
+    using Join = detail::ScatterJoin<std::decay_t<decltype(cb)>>;
+    auto join = std::make_shared<Join>(targets.size(), std::move(cb));
+    auto query = opts.query;
+    auto deadline = std::chrono::steady_clock::now() + opts.per_target_timeout;
+    if (!query.deadline || deadline < *query.deadline) {
+      query.deadline = deadline;
+    }
+    for (std::size_t i = 0; i < targets.size(); ++i) {
+      auto timer = std::make_shared<asio::steady_timer>(
+          targets[i]->get().get_executor());
+      timer->expires_after(opts.per_target_timeout);
+      timer->async_wait([join, i](const boost::system::error_code& ec) {
+        if (ec) return;  // cancelled: target completed first
+        join->finish(i, [i](ScatterResult& r) { r.timed_out.push_back(i); });
+      });
+      session->run_query_on_pool(*targets[i], sql, query)
+          .run([join, i, timer](auto r) {
+            timer->cancel();
+            join->finish(i, [&](ScatterResult& out) {
+              if (r.is_err()) {
+                auto code = r.error().code;
+                if (code == db_errors::SQL_EXEC::DEADLINE_EXCEEDED) {
+                  out.timed_out.push_back(i);
+                } else {
+                  out.failed.emplace_back(i, r.error());
+                }
+                return;
+              }
+              auto state = std::move(r.value());
+              if (state.has_error()) {
+                out.failed.emplace_back(i, state.sql_failed_error());
+                return;
+              }
+              // Hand the connection back now; results own their buffers.
+              state.conn = MysqlSessionState::TrackedPooledConn();
+              out.parts.push_back(ScatterPart{i, std::move(state)});
+            });
+          });
+    }
+  });
+}
+
+// Strict weak ordering over rows, as in ORDER BY.
+using RowLess = std::function<bool(mysql::row_view, mysql::row_view)>;
+
+namespace detail {
+
+// DECIMAL text ("-0012.50") split into sign and significant digits.
+struct DecimalText {
+  bool negative{false};
+  std::string_view whole;     // no leading zeros
+  std::string_view fraction;  // no trailing zeros
+};
+
+inline bool parse_decimal(std::string_view text, DecimalText& out) {
+  std::size_t pos = 0;
+  out = DecimalText{};
+  if (pos < text.size() && (text[pos] == '-' || text[pos] == '+')) {
+    out.negative = text[pos] == '-';
+    ++pos;
+  }
+  auto digits = [&text](std::size_t from) {
+    auto to = from;
+    while (to < text.size() && text[to] >= '0' && text[to] <= '9') ++to;
+    return to;
+  };
+  auto whole_end = digits(pos);
+  out.whole = text.substr(pos, whole_end - pos);
+  pos = whole_end;
+  if (pos < text.size() && text[pos] == '.') {
+    auto fraction_end = digits(pos + 1);
+    out.fraction = text.substr(pos + 1, fraction_end - pos - 1);
+    pos = fraction_end;
+  }
+  if (pos != text.size() || (out.whole.empty() && out.fraction.empty())) {
+    return false;
+  }
+  while (!out.whole.empty() && out.whole.front() == '0') {
+    out.whole.remove_prefix(1);
+  }
+  while (!out.fraction.empty() && out.fraction.back() == '0') {
+    out.fraction.remove_suffix(1);
+  }
+  // "-0.00" is zero.
+  if (out.whole.empty() && out.fraction.empty()) out.negative = false;
+  return true;
+}
+
+}  // namespace detail
+
+// Exact numeric three-way comparison of two DECIMAL texts (as Boost.MySQL
+// returns DECIMAL columns). Falls back to byte order if either is not a
+// plain decimal number.
+inline int compare_decimal(std::string_view a, std::string_view b) {
+  detail::DecimalText x, y;
+  if (!detail::parse_decimal(a, x) || !detail::parse_decimal(b, y)) {
+    return a < b ? -1 : (b < a ? 1 : 0);
+  }
+  if (x.negative != y.negative) return x.negative ? -1 : 1;
+  int magnitude = 0;
+  if (x.whole.size() != y.whole.size()) {
+    magnitude = x.whole.size() < y.whole.size() ? -1 : 1;
+  } else if (int c = x.whole.compare(y.whole); c != 0) {
+    magnitude = c < 0 ? -1 : 1;
+  } else if (int c = x.fraction.compare(y.fraction); c != 0) {
+    // Trailing zeros are stripped, so "5" < "51" orders .5 before .51.
+    magnitude = c < 0 ? -1 : 1;
+  }
+  return x.negative ? -magnitude : magnitude;
+}
+
+// Three-way comparison of two fields with MySQL-like semantics for the kinds
+// that appear in ORDER BY keys. NULL sorts first. Boost.MySQL hands DECIMAL
+// columns over as strings, so pass `type` (the column's metadata type,
+// results.meta()[i].type()) to have them compared numerically. Other
+// strings compare byte-wise, which only matches the server's order under a
+// binary collation: have the targets sort by such a key (e.g. ORDER BY
+// name COLLATE utf8mb4_bin) or merge with a RowLess that applies the same
+// collation as the server.
+inline int compare_fields(mysql::field_view a, mysql::field_view b,
+                          mysql::column_type type =
+                              mysql::column_type::unknown) {
+  if (a.is_null() || b.is_null()) {
+    return a.is_null() == b.is_null() ? 0 : (a.is_null() ? -1 : 1);
+  }
+  auto three_way = [](const auto& x, const auto& y) {
+    return x < y ? -1 : (y < x ? 1 : 0);
+  };
+  auto numeric = [](mysql::field_view f, long double& out) {
+    switch (f.kind()) {
+      case mysql::field_kind::int64:
+        out = static_cast<long double>(f.as_int64());
+        return true;
+      case mysql::field_kind::uint64:
+        out = static_cast<long double>(f.as_uint64());
+        return true;
+      case mysql::field_kind::float_:
+        out = f.as_float();
+        return true;
+      case mysql::field_kind::double_:
+        out = f.as_double();
+        return true;
+      default:
+        return false;
+    }
+  };
+  if (a.kind() == mysql::field_kind::int64 &&
+      b.kind() == mysql::field_kind::int64) {
+    return three_way(a.as_int64(), b.as_int64());
+  }
+  if (a.kind() == mysql::field_kind::uint64 &&
+      b.kind() == mysql::field_kind::uint64) {
+    return three_way(a.as_uint64(), b.as_uint64());
+  }
+  long double na = 0, nb = 0;
+  if (numeric(a, na) && numeric(b, nb)) return three_way(na, nb);
+  if (a.kind() == mysql::field_kind::string &&
+      b.kind() == mysql::field_kind::string) {
+    if (type == mysql::column_type::decimal) {
+      return compare_decimal(a.as_string(), b.as_string());
+    }
+    return three_way(a.as_string(), b.as_string());
+  }
+  if (a.kind() == mysql::field_kind::datetime &&
+      b.kind() == mysql::field_kind::datetime) {
+    return three_way(a.as_datetime().as_time_point(),
+                     b.as_datetime().as_time_point());
+  }
+  if (a.kind() == mysql::field_kind::date &&
+      b.kind() == mysql::field_kind::date) {
+    return three_way(a.as_date().as_time_point(),
+                     b.as_date().as_time_point());
+  }
+  return three_way(static_cast<int>(a.kind()), static_cast<int>(b.kind()));
+}
+
+// ORDER BY <column> [DESC]; `type` as for compare_fields().
+inline RowLess order_by(
+    std::size_t column, bool descending = false,
+    mysql::column_type type = mysql::column_type::unknown) {
+  return [column, descending, type](mysql::row_view a, mysql::row_view b) {
+    int c = compare_fields(a.at(column), b.at(column), type);
+    return descending ? c > 0 : c < 0;
+  };
+}
+
+// k-way merge of sorted runs (any random-access ranges of rows). Invokes
+// on_row(row) in global order for at most `limit` rows and returns how many
+// rows were visited. Rows comparing equal are taken from the lower-numbered
+// run first. A binary heap keeps one cursor per run, so the work is
+// O(limit * log(runs)).
+template <class Rows, class Less, class F>
+std::size_t merge_runs(const std::vector<Rows>& runs, const Less& less,
+                       std::size_t limit, F&& on_row) {
+  struct Cursor {
+    const Rows* rows;
+    std::size_t pos;
+  };
+  std::vector<Cursor> cursors;
+  cursors.reserve(runs.size());
+  for (const auto& rows : runs) {
+    if (!rows.empty()) cursors.push_back(Cursor{&rows, 0});
+  }
+  // priority_queue is a max-heap; invert so the smallest row is on top.
+  auto heap_cmp = [&](std::size_t x, std::size_t y) {
+    const auto& rx = (*cursors[x].rows)[cursors[x].pos];
+    const auto& ry = (*cursors[y].rows)[cursors[y].pos];
+    if (less(ry, rx)) return true;
+    return !less(rx, ry) && y < x;
+  };
+  std::priority_queue<std::size_t, std::vector<std::size_t>,
+                      decltype(heap_cmp)>
+      heap(heap_cmp);
+  for (std::size_t i = 0; i < cursors.size(); ++i) heap.push(i);
+
+  std::size_t emitted = 0;
+  while (!heap.empty() && emitted < limit) {
+    auto top = heap.top();
+    heap.pop();
+    on_row((*cursors[top].rows)[cursors[top].pos]);
+    ++emitted;
+    if (++cursors[top].pos < cursors[top].rows->size()) heap.push(top);
+  }
+  return emitted;
+}
+
+// merge_runs() over result `result_index` of every part. Each part must
+// already be sorted by `less` (i.e. every target ran the same ORDER BY ...
+// LIMIT n).
+template <class F>
+std::size_t merge_ordered(const ScatterResult& result, const RowLess& less,
+                          std::size_t limit, F&& on_row,
+                          std::size_t result_index = 0) {
+  std::vector<mysql::rows_view> runs;
+  runs.reserve(result.parts.size());
+  for (const auto& part : result.parts) {
+    if (part.state.results.size() <= result_index) continue;
+    runs.push_back(part.state.results[result_index].rows());
+  }
+  return merge_runs(runs, less, limit, std::forward<F>(on_row));
+}
+
+// Adds one partial aggregate to `total`. MySQL returns COUNT(*) as BIGINT
+// but SUM() of integer or DECIMAL columns as DECIMAL (a string field),
+// which is parsed here; a DECIMAL with a fractional part, or one out of
+// int64 range, is an error. NULL partials (SUM over an empty shard) count
+// as zero.
+inline MyVoidResult add_partial(int64_t& total, mysql::field_view f) {
+  constexpr auto kMax = std::numeric_limits<int64_t>::max();
+  auto overflow = [] {
+    return MyVoidResult::Err(Error{db_errors::PARSE::BAD_VALUE_ACCESS,
+                                   "partial aggregate: int64 overflow"});
+  };
+  int64_t v = 0;
+  switch (f.kind()) {
+    case mysql::field_kind::null:
+      return MyVoidResult();
+    case mysql::field_kind::int64:
+      v = f.as_int64();
+      break;
+    case mysql::field_kind::uint64:
+      if (f.as_uint64() > static_cast<uint64_t>(kMax)) return overflow();
+      v = static_cast<int64_t>(f.as_uint64());
+      break;
+    case mysql::field_kind::string: {
+      detail::DecimalText d;
+      if (!detail::parse_decimal(f.as_string(), d) || !d.fraction.empty()) {
+        return MyVoidResult::Err(
+            Error{db_errors::PARSE::BAD_VALUE_ACCESS,
+                  "partial aggregate: expecting an integral DECIMAL"});
+      }
+      uint64_t magnitude = 0;
+      if (!d.whole.empty()) {
+        auto [end, ec] = std::from_chars(
+            d.whole.data(), d.whole.data() + d.whole.size(), magnitude);
+        if (ec != std::errc()) return overflow();
+      }
+      uint64_t limit = static_cast<uint64_t>(kMax) + (d.negative ? 1 : 0);
+      if (magnitude > limit) return overflow();
+      v = d.negative ? static_cast<int64_t>(0 - magnitude)
+                     : static_cast<int64_t>(magnitude);
+      break;
+    }
+    default:
+      return MyVoidResult::Err(Error{db_errors::PARSE::BAD_VALUE_ACCESS,
+                                     "partial aggregate: expecting integer"});
+  }
+  if (v > 0 ? total > kMax - v
+            : total < std::numeric_limits<int64_t>::min() - v) {
+    return overflow();
+  }
+  total += v;
+  return MyVoidResult();
+}
+
+// Same for a double total: accepts DOUBLE, FLOAT, integers and DECIMAL.
+inline MyVoidResult add_partial(double& total, mysql::field_view f) {
+  switch (f.kind()) {
+    case mysql::field_kind::null:
+      return MyVoidResult();
+    case mysql::field_kind::int64:
+      total += static_cast<double>(f.as_int64());
+      return MyVoidResult();
+    case mysql::field_kind::uint64:
+      total += static_cast<double>(f.as_uint64());
+      return MyVoidResult();
+    case mysql::field_kind::float_:
+      total += f.as_float();
+      return MyVoidResult();
+    case mysql::field_kind::double_:
+      total += f.as_double();
+      return MyVoidResult();
+    case mysql::field_kind::string: {
+      auto text = f.as_string();
+      detail::DecimalText d;
+      double v = 0;
+      auto first = text.data() + (!text.empty() && text.front() == '+');
+      auto last = text.data() + text.size();
+      if (detail::parse_decimal(text, d)) {
+        auto [end, ec] = std::from_chars(first, last, v);
+        if (ec == std::errc() && end == last) {
+          total += v;
+          return MyVoidResult();
+        }
+      }
+      [[fallthrough]];
+    }
+    default:
+      return MyVoidResult::Err(Error{db_errors::PARSE::BAD_VALUE_ACCESS,
+                                     "partial aggregate: expecting number"});
+  }
+}
+
+namespace detail {
+
+// Field `column` of the first row of result `result_index` of a part.
+inline MyResult<mysql::field_view> partial_field(const ScatterPart& part,
+                                                 std::size_t result_index,
+                                                 std::size_t column) {
+  const auto& results = part.state.results;
+  if (results.size() <= result_index) {
+    return MyResult<mysql::field_view>::Err(
+        Error{db_errors::SQL_EXEC::INDEX_OUT_OF_BOUNDS, "partial aggregate"});
+  }
+  auto rows = results[result_index].rows();
+  if (rows.empty()) {
+    return MyResult<mysql::field_view>::Err(
+        Error{db_errors::SQL_EXEC::NO_ROWS, "partial aggregate"});
+  }
+  if (rows[0].size() <= column) {
+    return MyResult<mysql::field_view>::Err(
+        Error{db_errors::SQL_EXEC::INDEX_OUT_OF_BOUNDS, "partial aggregate"});
+  }
+  return MyResult<mysql::field_view>::Ok(rows[0].at(column));
+}
+
+template <class T>
+MyResult<T> sum_partials(const ScatterResult& result,
+                         std::size_t result_index, std::size_t column) {
+  T total = 0;
+  for (const auto& part : result.parts) {
+    auto f = partial_field(part, result_index, column);
+    if (f.is_err()) return MyResult<T>::Err(f.error());
+    auto added = add_partial(total, f.value());
+    if (added.is_err()) return MyResult<T>::Err(added.error());
+  }
+  return MyResult<T>::Ok(total);
+}
+
+}  // namespace detail
+
+// Combines per-target partial aggregates (COUNT(*), SUM(x) of integers)
+// found in the first row of result `result_index`, column `column`; see
+// add_partial().
+inline MyResult<int64_t> sum_partials_int64(const ScatterResult& result,
+                                            int result_index = 0,
+                                            int column = 0) {
+  return detail::sum_partials<int64_t>(result, result_index, column);
+}
+
+// Same as sum_partials_int64 for DOUBLE and fractional DECIMAL partials.
+inline MyResult<double> sum_partials_double(const ScatterResult& result,
+                                            int result_index = 0,
+                                            int column = 0) {
+  return detail::sum_partials<double>(result, result_index, column);
+}
+
+}  // namespace monad
@@ -0,0 +1,90 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "mysql_config_provider.hpp"
+
+namespace sql {
+
+enum class ShardStrategy { Hash, Range };
+
+// splitmix64 finalizer: cheap, stateless and well distributed for
+// sequential ids such as customer_id.
+inline uint64_t shard_hash(uint64_t key) noexcept {
+  key += 0x9e3779b97f4a7c15ULL;
+  key = (key ^ (key >> 30)) * 0xbf58476d1ce4e5b9ULL;
+  key = (key ^ (key >> 27)) * 0x94d049bb133111ebULL;
+  return key ^ (key >> 31);
+}
+
+// FNV-1a for string keys (tenant slugs, uuids, ...).
+inline uint64_t shard_hash(std::string_view key) noexcept {
+  uint64_t h = 0xcbf29ce484222325ULL;
+  for (unsigned char c : key) {
+    h ^= c;
+    h *= 0x100000001b3ULL;
+  }
+  return shard_hash(h);
+}
+
+// ShardMap
+// --------------------------------------------------------------------
+// Immutable description of how keys map to shards. route() is a pure
+// function of (key, map) so callers can evaluate it on any thread without
+// synchronization; pool creation is handled separately by MysqlPoolWrapper.
+//
+// JSON (inside mysql_config):
+//   "shards": [ { "database": "cust_0" }, { "host": "db2", ... } ],
+//   "shard_strategy": "hash" | "range",
+//   "shard_range_bounds": [ 100000, 200000 ]
+// Shard entries overlay the primary config (see MysqlConfig::overlay), so
+// several schemas on one server only need a "database" per entry.
+// For "range", bound i is the exclusive upper key of shard i; the last shard
+// takes every key >= the last bound (bounds.size() == shards.size() - 1).
+struct ShardMap {
+  std::vector<MysqlConfig> shards;
+  ShardStrategy strategy{ShardStrategy::Hash};
+  std::vector<int64_t> range_bounds;
+
+  static ShardMap from_config(const MysqlConfig& config) {
+    ShardMap map;
+    map.shards = config.shards;
+    map.strategy = config.shard_strategy == "range" ? ShardStrategy::Range
+                                                    : ShardStrategy::Hash;
+    map.range_bounds = config.shard_range_bounds;
+    if (map.strategy == ShardStrategy::Range && !map.shards.empty() &&
+        map.range_bounds.size() + 1 != map.shards.size()) {
+      throw std::runtime_error(
+          "shard_range_bounds must have exactly shards.size() - 1 entries");
+    }
+    if (!std::is_sorted(map.range_bounds.begin(), map.range_bounds.end())) {
+      throw std::runtime_error("shard_range_bounds must be ascending");
+    }
+    return map;
+  }
+
+  bool empty() const noexcept { return shards.empty(); }
+  std::size_t size() const noexcept { return shards.size(); }
+
+  // Index of the shard owning key. Requires !empty().
+  std::size_t route(int64_t key) const noexcept {
+    if (strategy == ShardStrategy::Range) {
+      auto it =
+          std::upper_bound(range_bounds.begin(), range_bounds.end(), key);
+      return static_cast<std::size_t>(it - range_bounds.begin());
+    }
+    return shard_hash(static_cast<uint64_t>(key)) % shards.size();
+  }
+
+  // String keys are always hashed.
+  std::size_t route(std::string_view key) const noexcept {
+    return shard_hash(key) % shards.size();
+  }
+};
+
+}  // namespace sql
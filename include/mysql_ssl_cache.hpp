@@ -0,0 +1,175 @@
+#pragma once
+
+#include <openssl/ssl.h>
+
+#include <atomic>
+#include <boost/asio/ssl.hpp>  // IWYU pragma: keep
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+
+namespace sql {
+
+// Process-wide TLS counters for MySQL connections (all pools share the
+// cached contexts, so they are not per pool).
+struct TlsMetrics {
+  std::atomic<uint64_t> contexts_built{0};
+  std::atomic<uint64_t> context_cache_hits{0};
+  std::atomic<uint64_t> handshakes{0};
+  std::atomic<uint64_t> resumed{0};
+};
+
+inline TlsMetrics& tls_metrics() {
+  static TlsMetrics metrics;
+  return metrics;
+}
+
+// SslContextCache
+// --------------------------------------------------------------------
+// Builds the client ssl::context (base64 decode + PEM parsing) once per
+// fingerprint. Every pool built from the same fingerprint holds the same
+// Entry and hands boost::mysql an ssl::context sharing its SSL_CTX
+// (reference counted through SSL_CTX_up_ref). The cache itself only keeps
+// weak references: an entry, with its stored session, goes away with the
+// last pool using it, so rotated credentials or retired servers do not
+// accumulate.
+//
+// TLS session resumption: the shared SSL_CTX keeps the most recent session
+// of its server (new-session callback) and offers it on the next handshake.
+// boost::mysql creates the SSL objects internally, so the session is set
+// from the info callback at SSL_CB_HANDSHAKE_START, which OpenSSL runs
+// before the ClientHello is built. Resumed handshakes skip the certificate
+// exchange and are counted in tls_metrics().resumed. The fingerprint
+// includes host:port so a stored session is only offered to the server
+// that issued it.
+class SslContextCache {
+ public:
+  class Entry {
+   public:
+    Entry(std::string fingerprint, boost::asio::ssl::context&& ctx)
+        : fingerprint_(std::move(fingerprint)), ctx_(std::move(ctx)) {}
+    Entry(const Entry&) = delete;
+    Entry& operator=(const Entry&) = delete;
+    // Callbacks of connections still using the SSL_CTX find no entry from
+    // here on (pools release their entry only after closing them).
+    ~Entry() {
+      SSL_CTX_set_ex_data(ctx_.native_handle(), ex_index(), nullptr);
+      if (session_) SSL_SESSION_free(session_);
+      instance().forget(fingerprint_);
+    }
+
+    // A context sharing this entry's SSL_CTX, for pool_params::ssl_ctx.
+    boost::asio::ssl::context share() {
+      SSL_CTX* handle = ctx_.native_handle();
+      SSL_CTX_up_ref(handle);
+      return boost::asio::ssl::context(handle);  // adopts the reference
+    }
+    SSL_CTX* native_handle() { return ctx_.native_handle(); }
+
+   private:
+    friend class SslContextCache;
+    std::string fingerprint_;
+    boost::asio::ssl::context ctx_;
+    std::mutex mu_;
+    SSL_SESSION* session_{nullptr};
+  };
+
+  static SslContextCache& instance() {
+    // Never destroyed: SSL_CTX/SSL_SESSION frees must not run after
+    // OpenSSL's own atexit cleanup.
+    static auto* cache = new SslContextCache();
+    return *cache;
+  }
+
+  // The live entry for `fingerprint`, built with `build` when no pool holds
+  // one. Keep the returned entry for as long as contexts shared from it
+  // are in use.
+  std::shared_ptr<Entry> get(
+      const std::string& fingerprint,
+      const std::function<boost::asio::ssl::context()>& build) {
+    std::lock_guard<std::mutex> lock(mu_);
+    auto it = entries_.find(fingerprint);
+    if (it != entries_.end()) {
+      if (auto entry = it->second.lock()) {
+        tls_metrics().context_cache_hits.fetch_add(
+            1, std::memory_order_relaxed);
+        return entry;
+      }
+    }
+    auto entry = std::make_shared<Entry>(fingerprint, build());
+    install(*entry);
+    entries_[fingerprint] = entry;
+    tls_metrics().contexts_built.fetch_add(1, std::memory_order_relaxed);
+    return entry;
+  }
+
+  // Fingerprints with a live entry.
+  std::size_t size() const {
+    std::lock_guard<std::mutex> lock(mu_);
+    return entries_.size();
+  }
+
+ private:
+  SslContextCache() = default;
+
+  // Called by a dying entry; keeps a replacement built meanwhile.
+  void forget(const std::string& fingerprint) {
+    std::lock_guard<std::mutex> lock(mu_);
+    auto it = entries_.find(fingerprint);
+    if (it != entries_.end() && it->second.expired()) entries_.erase(it);
+  }
+
+  static int ex_index() {
+    static const int index =
+        SSL_CTX_get_ex_new_index(0, nullptr, nullptr, nullptr, nullptr);
+    return index;
+  }
+
+  static Entry* entry_of(const SSL* ssl) {
+    return static_cast<Entry*>(
+        SSL_CTX_get_ex_data(SSL_get_SSL_CTX(ssl), ex_index()));
+  }
+
+  static void install(Entry& entry) {
+    SSL_CTX* handle = entry.native_handle();
+    SSL_CTX_set_ex_data(handle, ex_index(), &entry);
+    SSL_CTX_set_session_cache_mode(
+        handle, SSL_SESS_CACHE_CLIENT | SSL_SESS_CACHE_NO_INTERNAL_STORE);
+    SSL_CTX_sess_set_new_cb(handle, &SslContextCache::on_new_session);
+    SSL_CTX_set_info_callback(handle, &SslContextCache::on_info);
+  }
+
+  // Keeps the newest session (we take over the reference by returning 1).
+  static int on_new_session(SSL* ssl, SSL_SESSION* session) {
+    auto* entry = entry_of(ssl);
+    if (!entry) return 0;
+    std::lock_guard<std::mutex> lock(entry->mu_);
+    if (entry->session_) SSL_SESSION_free(entry->session_);
+    entry->session_ = session;
+    return 1;
+  }
+
+  static void on_info(const SSL* ssl, int where, int /*ret*/) {
+    if (where & SSL_CB_HANDSHAKE_START) {
+      auto* entry = entry_of(ssl);
+      if (!entry || SSL_get_session(ssl)) return;
+      std::lock_guard<std::mutex> lock(entry->mu_);
+      if (entry->session_ && SSL_SESSION_is_resumable(entry->session_)) {
+        SSL_set_session(const_cast<SSL*>(ssl), entry->session_);
+      }
+    } else if (where & SSL_CB_HANDSHAKE_DONE) {
+      tls_metrics().handshakes.fetch_add(1, std::memory_order_relaxed);
+      if (SSL_session_reused(const_cast<SSL*>(ssl))) {
+        tls_metrics().resumed.fetch_add(1, std::memory_order_relaxed);
+      }
+    }
+  }
+
+  mutable std::mutex mu_;
+  std::map<std::string, std::weak_ptr<Entry>> entries_;
+};
+
+}  // namespace sql
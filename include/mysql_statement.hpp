@@ -0,0 +1,218 @@
+#pragma once
+
+#include <cctype>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+namespace sql {
+
+// Lightweight statement inspection helpers.
+// --------------------------------------------------------------------
+// These are NOT a SQL parser. They look at the leading keyword of every
+// statement in a (possibly multi-statement) string, skipping whitespace,
+// comments and quoted literals, so routing code can make cheap decisions
+// such as "can this run on a replica". When in doubt they answer
+// conservatively (i.e. treat the text as a write).
+
+namespace detail {
+
+// Skips whitespace and SQL comments (-- , #, /* */) starting at pos.
+inline std::size_t skip_blank(std::string_view s, std::size_t pos) {
+  while (pos < s.size()) {
+    char c = s[pos];
+    if (std::isspace(static_cast<unsigned char>(c))) {
+      ++pos;
+    } else if (c == '#' ||
+               (c == '-' && pos + 1 < s.size() && s[pos + 1] == '-')) {
+      auto nl = s.find('\n', pos);
+      pos = nl == std::string_view::npos ? s.size() : nl + 1;
+    } else if (c == '/' && pos + 1 < s.size() && s[pos + 1] == '*') {
+      // Optimizer hints (/*+ ... */) are comments as far as routing goes.
+      auto end = s.find("*/", pos + 2);
+      pos = end == std::string_view::npos ? s.size() : end + 2;
+    } else {
+      break;
+    }
+  }
+  return pos;
+}
+
+// Returns the position just past the statement starting at pos: either the
+// index after the terminating ';' or s.size(). Quoted literals and
+// identifiers are skipped so a ';' inside them does not split statements.
+inline std::size_t statement_end(std::string_view s, std::size_t pos) {
+  while (pos < s.size()) {
+    char c = s[pos];
+    if (c == '\'' || c == '"' || c == '`') {
+      ++pos;
+      while (pos < s.size() && s[pos] != c) {
+        if (s[pos] == '\\' && c != '`') ++pos;
+        ++pos;
+      }
+      ++pos;
+    } else if (c == ';') {
+      return pos + 1;
+    } else {
+      ++pos;
+    }
+  }
+  return s.size();
+}
+
+inline std::string upper_word_at(std::string_view s, std::size_t pos) {
+  std::string word;
+  while (pos < s.size() &&
+         (std::isalpha(static_cast<unsigned char>(s[pos])) || s[pos] == '_')) {
+    word.push_back(
+        static_cast<char>(std::toupper(static_cast<unsigned char>(s[pos]))));
+    ++pos;
+  }
+  return word;
+}
+
+inline std::string to_upper(std::string_view text) {
+  std::string upper;
+  upper.reserve(text.size());
+  for (char c : text) {
+    upper.push_back(
+        static_cast<char>(std::toupper(static_cast<unsigned char>(c))));
+  }
+  return upper;
+}
+
+}  // namespace detail
+
+// Invokes f(keyword, statement_text) for every non-empty statement in sql.
+// keyword is the upper-cased leading keyword ("SELECT", "INSERT", ...).
+// Stops early and returns false as soon as f returns false.
+template <class F>
+bool for_each_statement(std::string_view sql, F&& f) {
+  std::size_t pos = 0;
+  while (pos < sql.size()) {
+    auto start = detail::skip_blank(sql, pos);
+    if (start >= sql.size()) break;
+    auto end = detail::statement_end(sql, start);
+    if (sql[start] != ';') {
+      auto text = sql.substr(start, end - start);
+      if (!f(detail::upper_word_at(sql, start), text)) return false;
+    }
+    pos = end;
+  }
+  return true;
+}
+
+// Upper-cased leading keyword of the first statement, or "" if none.
+inline std::string leading_keyword(std::string_view sql) {
+  auto pos = detail::skip_blank(sql, 0);
+  return detail::upper_word_at(sql, pos);
+}
+
+// Number of non-empty statements in sql.
+inline std::size_t statement_count(std::string_view sql) {
+  std::size_t n = 0;
+  for_each_statement(sql, [&n](const std::string&, std::string_view) {
+    ++n;
+    return true;
+  });
+  return n;
+}
+
+// True when every statement in sql is a plain read (SELECT / SHOW /
+// DESCRIBE / EXPLAIN) that cannot create a GTID. SELECT ... INTO and
+// SELECT ... FOR UPDATE are treated as writes because they either persist
+// data or must observe the primary's locks.
+inline bool is_read_only_statement(std::string_view sql) {
+  bool any = false;
+  bool ok = for_each_statement(sql, [&](const std::string& kw,
+                                        std::string_view text) {
+    any = true;
+    if (kw == "SHOW" || kw == "DESCRIBE" || kw == "DESC" || kw == "EXPLAIN") {
+      return true;
+    }
+    if (kw != "SELECT") return false;
+    auto upper = detail::to_upper(text);
+    return upper.find(" INTO ") == std::string::npos &&
+           upper.find("FOR UPDATE") == std::string::npos &&
+           upper.find("FOR SHARE") == std::string::npos &&
+           upper.find("LOCK IN SHARE MODE") == std::string::npos;
+  });
+  return any && ok;
+}
+
+// True when running sql cannot leave session state behind for the next
+// borrower of the connection, so it may skip the reset on return. Only
+// plain reads, UPDATE and DELETE qualify; SET, USE, transactions (BEGIN /
+// START / COMMIT / ROLLBACK / SAVEPOINT / XA), LOCK/UNLOCK TABLES, PREPARE
+// / EXECUTE, temporary tables, CALL (procedures can do any of these), user
+// variable assignment (:= or INTO @var), named locks (GET_LOCK) and
+// SQL_CALC_FOUND_ROWS all require a reset. So do INSERT and REPLACE, and
+// LAST_INSERT_ID(expr) anywhere: the next borrower would otherwise read
+// this one's LAST_INSERT_ID(). ROW_COUNT() is overwritten by the session
+// setup every acquisition runs, and FOUND_ROWS() is only meaningful after
+// a SELECT of the same borrower. Note that a plain DML statement under
+// autocommit = 0 would leave a transaction open; sessions that turn
+// autocommit off go through SET and are therefore reset anyway.
+inline bool is_session_stateless(std::string_view sql) {
+  bool any = false;
+  bool ok = for_each_statement(sql, [&](const std::string& kw,
+                                        std::string_view text) {
+    any = true;
+    if (kw != "SELECT" && kw != "UPDATE" && kw != "DELETE" &&
+        kw != "WITH" && kw != "SHOW" && kw != "DESCRIBE" && kw != "DESC" &&
+        kw != "EXPLAIN" && kw != "TABLE" && kw != "VALUES") {
+      return false;
+    }
+    auto upper = detail::to_upper(text);
+    constexpr std::string_view kLastInsertId = "LAST_INSERT_ID";
+    for (auto at = upper.find(kLastInsertId); at != std::string::npos;
+         at = upper.find(kLastInsertId, at + 1)) {
+      auto open = detail::skip_blank(upper, at + kLastInsertId.size());
+      if (open >= upper.size() || upper[open] != '(') continue;
+      auto arg = detail::skip_blank(upper, open + 1);
+      // LAST_INSERT_ID(expr) sets the value; LAST_INSERT_ID() only reads it.
+      if (arg < upper.size() && upper[arg] != ')') return false;
+    }
+    return upper.find(":=") == std::string::npos &&
+           upper.find("INTO @") == std::string::npos &&
+           upper.find("GET_LOCK") == std::string::npos &&
+           upper.find("RELEASE_LOCK") == std::string::npos &&
+           upper.find("RELEASE_ALL_LOCKS") == std::string::npos &&
+           upper.find("SQL_CALC_FOUND_ROWS") == std::string::npos;
+  });
+  return any && ok;
+}
+
+// Adds a MAX_EXECUTION_TIME(ms) optimizer hint to a single top-level SELECT
+// so the server aborts it on its own. Anything else (DML, multi-statement
+// text, statements that already carry the hint) is returned unchanged; the
+// hint is only honored on read-only SELECTs anyway. An existing hint block
+// after SELECT is extended, as MySQL accepts only one.
+inline std::string with_max_execution_time(std::string_view sql,
+                                           uint64_t ms) {
+  auto start = detail::skip_blank(sql, 0);
+  if (statement_count(sql) != 1 ||
+      detail::upper_word_at(sql, start) != "SELECT" ||
+      detail::to_upper(sql).find("MAX_EXECUTION_TIME") != std::string::npos) {
+    return std::string(sql);
+  }
+  auto hint = "MAX_EXECUTION_TIME(" + std::to_string(ms) + ")";
+  auto after = start + 6;
+  auto next = after;
+  while (next < sql.size() &&
+         std::isspace(static_cast<unsigned char>(sql[next]))) {
+    ++next;
+  }
+  std::string out(sql.substr(0, after));
+  if (sql.substr(next, 3) == "/*+") {
+    out.append(sql.substr(after, next + 3 - after));
+    out.append(" " + hint);
+    out.append(sql.substr(next + 3));
+  } else {
+    out.append(" /*+ " + hint + " */");
+    out.append(sql.substr(after));
+  }
+  return out;
+}
+
+}  // namespace sql
@@ -0,0 +1,208 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <string>
+#include <string_view>
+
+namespace sql {
+
+enum class TenantPolicy { Reject, Queue };
+
+// Limits for one tenant (QueryOptions::tenant). Zero means unlimited.
+struct TenantLimits {
+  // Sustained queries per second and how many may start back to back.
+  // burst defaults to max(qps, 1).
+  double qps{0};
+  double burst{0};
+  // Queries of the tenant running at once (acquisition included).
+  uint32_t max_in_flight{0};
+  // Over the limit: fail right away, or wait up to max_queue_wait (and never
+  // past the query's deadline) for room.
+  TenantPolicy policy{TenantPolicy::Reject};
+  std::chrono::milliseconds max_queue_wait{500};
+
+  bool operator==(const TenantLimits&) const = default;
+};
+
+enum class TenantAdmission { Admitted, RateLimited, InFlightLimited };
+
+struct TenantVerdict {
+  TenantAdmission result{TenantAdmission::Admitted};
+  // When a retry could succeed; for the in-flight limit only a hint, as room
+  // appears whenever one of the tenant's queries completes.
+  std::chrono::steady_clock::duration retry_after{};
+};
+
+struct TenantMetrics {
+  std::atomic<uint64_t> admitted{0};
+  // Admissions that had to wait (TenantPolicy::Queue).
+  std::atomic<uint64_t> queued{0};
+  std::atomic<uint64_t> rejected_rate{0};
+  std::atomic<uint64_t> rejected_in_flight{0};
+};
+
+// TenantState
+// --------------------------------------------------------------------
+// Limits and counters of one tenant. try_acquire()/release() are lock-free:
+// the in-flight quota is a bounded atomic counter, the rate a GCRA
+// (virtual-scheduling token bucket) kept in one atomic "theoretical arrival
+// time", so concurrent callers settle with a CAS instead of a mutex.
+class TenantState {
+ public:
+  using Clock = std::chrono::steady_clock;
+  // Retry hint while the in-flight quota is exhausted.
+  static constexpr auto kInFlightRetry = std::chrono::milliseconds(5);
+
+  TenantState(std::string name, const TenantLimits& limits)
+      : name_(std::move(name)), limits_(limits) {
+    if (limits_.qps > 0) {
+      interval_ns_ = static_cast<int64_t>(1e9 / limits_.qps);
+      auto burst = limits_.burst > 0 ? limits_.burst
+                                     : std::max(limits_.qps, 1.0);
+      window_ns_ = static_cast<int64_t>(burst * 1e9 / limits_.qps);
+    }
+  }
+
+  TenantVerdict try_acquire(Clock::time_point now = Clock::now()) {
+    if (limits_.max_in_flight > 0) {
+      auto n = in_flight_.load(std::memory_order_relaxed);
+      do {
+        if (n >= limits_.max_in_flight) {
+          return {TenantAdmission::InFlightLimited, kInFlightRetry};
+        }
+      } while (!in_flight_.compare_exchange_weak(n, n + 1,
+                                                 std::memory_order_acquire,
+                                                 std::memory_order_relaxed));
+    } else {
+      in_flight_.fetch_add(1, std::memory_order_relaxed);
+    }
+    if (interval_ns_ > 0) {
+      int64_t t = now.time_since_epoch() / std::chrono::nanoseconds(1);
+      auto tat = tat_ns_.load(std::memory_order_relaxed);
+      int64_t next = 0;
+      do {
+        next = std::max(tat, t) + interval_ns_;
+        if (next - t > window_ns_) {
+          in_flight_.fetch_sub(1, std::memory_order_relaxed);
+          return {TenantAdmission::RateLimited,
+                  std::chrono::nanoseconds(next - t - window_ns_)};
+        }
+      } while (!tat_ns_.compare_exchange_weak(tat, next,
+                                              std::memory_order_relaxed));
+    }
+    metrics_.admitted.fetch_add(1, std::memory_order_relaxed);
+    return {};
+  }
+
+  // An admitted query completed.
+  void release() noexcept {
+    in_flight_.fetch_sub(1, std::memory_order_release);
+  }
+
+  const std::string& name() const { return name_; }
+  const TenantLimits& limits() const { return limits_; }
+  uint32_t in_flight() const {
+    return in_flight_.load(std::memory_order_relaxed);
+  }
+  TenantMetrics& metrics() { return metrics_; }
+  const TenantMetrics& metrics() const { return metrics_; }
+
+ private:
+  std::string name_;
+  TenantLimits limits_;
+  int64_t interval_ns_{0};
+  int64_t window_ns_{0};
+  std::atomic<int64_t> tat_ns_{0};
+  std::atomic<uint32_t> in_flight_{0};
+  TenantMetrics metrics_;
+};
+
+// TenantLimiter
+// --------------------------------------------------------------------
+// Per-tenant states of one pool, keyed by name. Limits come from config:
+// an entry per tenant plus "*" for every tenant not listed (without "*"
+// those are not limited). States are created on first sight in a fixed-size
+// open-addressing table of atomic pointers, so lookup and insertion are
+// lock-free too; once the table is full, further tenants share one
+// overflow state with the "*" limits. States live as long as the limiter.
+class TenantLimiter {
+ public:
+  static constexpr std::size_t kSlots = 1024;  // power of two
+
+  explicit TenantLimiter(std::map<std::string, TenantLimits, std::less<>>
+                             limits = {})
+      : limits_(std::move(limits)),
+        slots_(new std::atomic<TenantState*>[kSlots]),
+        overflow_("*", limits_for("*")) {
+    for (std::size_t i = 0; i < kSlots; ++i) slots_[i].store(nullptr);
+  }
+
+  TenantLimiter(const TenantLimiter&) = delete;
+  TenantLimiter& operator=(const TenantLimiter&) = delete;
+
+  ~TenantLimiter() {
+    for (std::size_t i = 0; i < kSlots; ++i) delete slots_[i].load();
+  }
+
+  // False when no limits are configured; callers skip the lookup.
+  bool enabled() const { return !limits_.empty(); }
+
+  TenantState& state(std::string_view tenant) {
+    auto h = std::hash<std::string_view>{}(tenant);
+    for (std::size_t probe = 0; probe < kSlots; ++probe) {
+      auto& slot = slots_[(h + probe) & (kSlots - 1)];
+      auto* p = slot.load(std::memory_order_acquire);
+      if (!p) {
+        auto fresh = std::make_unique<TenantState>(std::string(tenant),
+                                                   limits_for(tenant));
+        if (slot.compare_exchange_strong(p, fresh.get(),
+                                         std::memory_order_acq_rel)) {
+          return *fresh.release();
+        }
+      }
+      if (p->name() == tenant) return *p;
+    }
+    return overflow_;
+  }
+
+  // Existing state of a tenant, nullptr if it was never seen.
+  const TenantState* find(std::string_view tenant) const {
+    auto h = std::hash<std::string_view>{}(tenant);
+    for (std::size_t probe = 0; probe < kSlots; ++probe) {
+      auto* p = slots_[(h + probe) & (kSlots - 1)].load(
+          std::memory_order_acquire);
+      if (!p) return nullptr;
+      if (p->name() == tenant) return p;
+    }
+    return nullptr;
+  }
+
+  // Visits every tenant seen so far (for exporters).
+  template <class F>
+  void for_each(F&& f) const {
+    for (std::size_t i = 0; i < kSlots; ++i) {
+      if (auto* p = slots_[i].load(std::memory_order_acquire)) f(*p);
+    }
+    f(overflow_);
+  }
+
+ private:
+  TenantLimits limits_for(std::string_view tenant) const {
+    if (auto it = limits_.find(tenant); it != limits_.end()) return it->second;
+    if (auto it = limits_.find("*"); it != limits_.end()) return it->second;
+    return {};
+  }
+
+  std::map<std::string, TenantLimits, std::less<>> limits_;
+  std::unique_ptr<std::atomic<TenantState*>[]> slots_;
+  TenantState overflow_;
+};
+
+}  // namespace sql
@@ -1,8 +1,11 @@
 #include <gtest/gtest.h>
+#include <openssl/evp.h>
+#include <openssl/x509.h>
 
 #include <boost/asio/io_context.hpp>
 #include <cstdint>
 #include <filesystem>
+#include <future>
 #include <tuple>
 #include <thread>
 #include <chrono>
@@ -11,7 +14,9 @@
 #include "common_macros.hpp"
 #include "io_context_manager.hpp"
 #include "misc_util.hpp"
+#include "mysql_coro.hpp"
 #include "mysql_monad.hpp"
+#include "mysql_scatter.hpp"
 #include "result_monad.hpp"
 #include "tutil.hpp"  // IWYU pragma: keep
 #include "test_injectors.hpp"
@@ -41,6 +46,17 @@ class MysqlTestGlobalTestEnv : public ::testing::Environment {
 static const auto* const global_env =
     ::testing::AddGlobalTestEnvironment(new MysqlTestGlobalTestEnv());
 
+// Serves a fixed config, for pools a test builds for itself.
+class FixedMysqlConfigProvider : public sql::IMysqlConfigProvider {
+ public:
+  explicit FixedMysqlConfigProvider(sql::MysqlConfig config)
+      : config_(std::move(config)) {}
+  const sql::MysqlConfig& get() const override { return config_; }
+
+ private:
+  sql::MysqlConfig config_;
+};
+
 // Test fixture class to reduce duplication
 class MonadMysqlTest : public ::testing::Test {
   using Injector = decltype(test_injectors::build_unit_test_injector());
@@ -92,9 +108,33 @@ class MonadMysqlTest : public ::testing::Test {
   // Helper method to notify completion
   void notifyCompletion() { notifier_.notify(); }
 
+  // The pool behind session_ (a singleton of the injector).
+  sql::MysqlPoolWrapper& pool() {
+    return injector_->create<sql::MysqlPoolWrapper&>();
+  }
+
+  // A pool of its own on the MySQL IO thread, for tests that drain, reload
+  // or stop it; the injector's pool is shared by every test.
+  std::unique_ptr<sql::MysqlPoolWrapper> make_pool() {
+    if (!config_provider_) {
+      config_provider_ = std::make_unique<FixedMysqlConfigProvider>(
+          injector_->create<sql::IMysqlConfigProvider&>().get());
+    }
+    return std::make_unique<sql::MysqlPoolWrapper>(
+        injector_->create<cjj365::MysqlIoContextManager&>(),
+        *config_provider_);
+  }
+
+  std::shared_ptr<monad::MonadicMysqlSession> make_session(
+      sql::MysqlPoolWrapper& pool) {
+    return std::make_shared<monad::MonadicMysqlSession>(
+        pool, injector_->create<customio::IOutput&>());
+  }
+
   misc::ThreadNotifier notifier_;
   monad::MonadicMysqlSession::Factory session_factory_;
   std::shared_ptr<monad::MonadicMysqlSession> session_;
+  std::unique_ptr<FixedMysqlConfigProvider> config_provider_;
 };
 
 TEST_F(MonadMysqlTest, test_running_dir) {
@@ -399,4 +439,1055 @@ TEST_F(MonadMysqlTest, insert_verify_clean) {
   ASSERT_EQ(insert_row, 1);
   ASSERT_EQ(count, 1);
   ASSERT_GT(id, 0);
-}
\ No newline at end of file
+}
+TEST(MysqlStatementTest, read_only_classification) {
+  EXPECT_TRUE(sql::is_read_only_statement("SELECT * FROM film"));
+  EXPECT_TRUE(sql::is_read_only_statement(
+      "  /* lookup */ select 1; SELECT COUNT(*) FROM country;"));
+  EXPECT_TRUE(sql::is_read_only_statement("SHOW TABLES"));
+  EXPECT_TRUE(sql::is_read_only_statement("SELECT ';DELETE' AS s"));
+  EXPECT_FALSE(sql::is_read_only_statement("SELECT 1; DELETE FROM country"));
+  EXPECT_FALSE(sql::is_read_only_statement(
+      "SELECT * FROM film WHERE film_id = 1 FOR UPDATE"));
+  EXPECT_FALSE(sql::is_read_only_statement("INSERT INTO t VALUES (1)"));
+  EXPECT_FALSE(sql::is_read_only_statement(""));
+  EXPECT_EQ(sql::leading_keyword("-- c\n  update t set a = 1"), "UPDATE");
+}
+
+TEST(MysqlShardMapTest, range_and_hash_routing) {
+  sql::MysqlConfig config{};
+  config.shards.resize(3);
+  config.shard_strategy = "range";
+  config.shard_range_bounds = {100, 200};
+  auto range = sql::ShardMap::from_config(config);
+  EXPECT_EQ(range.route(int64_t{5}), 0u);
+  EXPECT_EQ(range.route(int64_t{100}), 1u);
+  EXPECT_EQ(range.route(int64_t{1000}), 2u);
+
+  config.shard_strategy = "hash";
+  config.shard_range_bounds.clear();
+  auto hash = sql::ShardMap::from_config(config);
+  std::vector<int> counts(3, 0);
+  for (int64_t customer_id = 1; customer_id <= 3000; ++customer_id) {
+    ++counts[hash.route(customer_id)];
+  }
+  for (int c : counts) EXPECT_GT(c, 800);
+  EXPECT_EQ(hash.route(int64_t{42}), hash.route(int64_t{42}));
+}
+
+TEST(MysqlPriorityGateTest, priority_order_and_aging) {
+  using namespace std::chrono_literals;
+  using Clock = sql::PriorityGate::Clock;
+  auto t0 = Clock::now();
+  sql::PriorityGate gate(1, 100ms);
+  std::string order;
+  ASSERT_TRUE(gate.acquire(sql::Priority::Normal, [] {}, t0));
+  EXPECT_FALSE(
+      gate.acquire(sql::Priority::Batch, [&] { order += 'b'; }, t0));
+  EXPECT_FALSE(
+      gate.acquire(sql::Priority::Interactive, [&] { order += 'i'; }, t0));
+  EXPECT_EQ(gate.waiting(), 2u);
+  gate.release(t0)();
+  gate.release(t0)();
+  EXPECT_EQ(order, "ib");
+  EXPECT_EQ(gate.in_use(), 1u);
+
+  // A background waiter queued long enough outranks a fresh interactive one.
+  order.clear();
+  EXPECT_FALSE(gate.acquire(sql::Priority::Background,
+                            [&] { order += 'B'; }, t0));
+  EXPECT_FALSE(gate.acquire(sql::Priority::Interactive,
+                            [&] { order += 'I'; }, t0 + 400ms));
+  gate.release(t0 + 500ms)();
+  EXPECT_EQ(order, "B");
+
+  // Growing capacity admits the remaining waiter immediately.
+  auto admitted = gate.set_capacity(2, t0 + 500ms);
+  ASSERT_EQ(admitted.size(), 1u);
+  admitted.front()();
+  EXPECT_EQ(order, "BI");
+  EXPECT_EQ(gate.in_use(), 2u);
+}
+
+TEST(MysqlAdmissionTest, limit_and_circuit_breaker) {
+  using namespace std::chrono_literals;
+  auto t0 = sql::AdmissionController::Clock::now();
+  sql::AdmissionOptions opts;
+  opts.max_limit = 4;
+  opts.breaker_threshold = 2;
+  opts.breaker_open = 100ms;
+  sql::AdmissionController ac(opts);
+
+  for (int i = 0; i < 4; ++i) {
+    ASSERT_EQ(ac.try_admit(t0), sql::Admission::Admitted);
+  }
+  EXPECT_EQ(ac.try_admit(t0), sql::Admission::Overloaded);
+  ac.release();
+  EXPECT_EQ(ac.try_admit(t0), sql::Admission::Admitted);
+
+  for (int i = 0; i < 4; ++i) ac.release();
+
+  // Latency far above the baseline shrinks the limit.
+  sql::AdmissionOptions wide;
+  wide.max_limit = 64;
+  sql::AdmissionController shrinking(wide);
+  for (int i = 0; i < 20; ++i) shrinking.record(1ms);
+  for (int i = 0; i < 20; ++i) shrinking.record(50ms);
+  EXPECT_LT(shrinking.limit(), 32u);
+
+  // Two consecutive failures open the circuit; one probe after the window.
+  ASSERT_EQ(ac.try_admit(t0), sql::Admission::Admitted);
+  EXPECT_FALSE(ac.on_failure(t0));
+  ASSERT_EQ(ac.try_admit(t0), sql::Admission::Admitted);
+  EXPECT_TRUE(ac.on_failure(t0));
+  EXPECT_EQ(ac.try_admit(t0 + 50ms), sql::Admission::CircuitOpen);
+  EXPECT_EQ(ac.try_admit(t0 + 150ms), sql::Admission::Admitted);
+  EXPECT_EQ(ac.try_admit(t0 + 150ms), sql::Admission::CircuitOpen);
+  ac.on_acquired();
+  EXPECT_FALSE(ac.circuit_open());
+  ac.release();
+  EXPECT_EQ(ac.in_flight(), 0u);
+}
+
+TEST(MysqlPoolSizerTest, raises_on_wait_and_lowers_after_cooldown) {
+  using namespace std::chrono_literals;
+  sql::PoolSizerOptions opts;
+  opts.floor = 2;
+  opts.ceiling = 10;
+  opts.target_wait = 20ms;
+  opts.grow_step = 4;
+  opts.cooldown = 30s;
+  sql::PoolSizer sizer(opts);
+  auto t0 = sql::PoolSizer::Clock::now();
+
+  auto d = sizer.evaluate(2, 2, 50ms, t0);
+  EXPECT_EQ(d.action, sql::ResizeAction::Raise);
+  EXPECT_EQ(d.to, 6u);
+  d = sizer.evaluate(8, 8, 50ms, t0 + 1s);
+  EXPECT_EQ(d.to, 10u);  // capped at ceiling
+  EXPECT_EQ(sizer.evaluate(10, 10, 50ms, t0 + 2s).action,
+            sql::ResizeAction::None);
+
+  // Quiet but still cooling down.
+  EXPECT_EQ(sizer.evaluate(10, 1, 1ms, t0 + 10s).action,
+            sql::ResizeAction::None);
+  d = sizer.evaluate(10, 1, 1ms, t0 + 40s);
+  EXPECT_EQ(d.action, sql::ResizeAction::Lower);
+  EXPECT_EQ(d.to, 6u);  // half of the headroom above the floor
+  // Waits inside the dead band neither raise nor lower the limit.
+  EXPECT_EQ(sizer.evaluate(6, 1, 15ms, t0 + 80s).action,
+            sql::ResizeAction::None);
+}
+
+TEST(MysqlKeepAliveTest, jitter_stays_within_spread) {
+  using namespace std::chrono_literals;
+  for (int i = 0; i < 1000; ++i) {
+    auto d = sql::jittered(1000ms, 0.25);
+    EXPECT_GE(d, 750ms);
+    EXPECT_LE(d, 1250ms);
+  }
+}
+
+TEST(MysqlPriorityGateTest, paces_growth_beyond_high_water) {
+  using namespace std::chrono_literals;
+  auto t0 = sql::PriorityGate::Clock::now();
+  sql::PriorityGate gate(10, 100ms);
+  sql::ConnectPacerOptions pacing;
+  pacing.rate_per_sec = 10;
+  pacing.burst = 2;
+  pacing.backoff_base = 1s;
+  gate.enable_pacing(pacing);
+
+  ASSERT_TRUE(gate.acquire(sql::Priority::Normal, [] {}, t0));
+  ASSERT_TRUE(gate.acquire(sql::Priority::Normal, [] {}, t0));
+  int granted = 0;
+  EXPECT_FALSE(gate.acquire(sql::Priority::Normal, [&] { ++granted; }, t0));
+  auto wake = gate.pacing_wakeup(t0);
+  ASSERT_TRUE(wake.has_value());
+  EXPECT_GE(*wake, t0 + 90ms);
+  EXPECT_TRUE(gate.admit_ready(t0 + 50ms).empty());
+  auto ready = gate.admit_ready(t0 + 100ms);
+  ASSERT_EQ(ready.size(), 1u);
+  ready.front()();
+  EXPECT_EQ(granted, 1);
+
+  // Below the high-water mark connections exist already: no token needed.
+  EXPECT_TRUE(gate.release(t0 + 100ms) == nullptr);
+  EXPECT_TRUE(gate.acquire(sql::Priority::Normal, [] {}, t0 + 100ms));
+
+  // A connect failure backs off further growth.
+  gate.on_connect_failure(t0 + 100ms);
+  EXPECT_FALSE(gate.acquire(sql::Priority::Normal, [] {}, t0 + 400ms));
+  EXPECT_GE(*gate.pacing_wakeup(t0 + 400ms), t0 + 600ms);
+}
+
+TEST(MysqlPriorityGateTest, only_connect_errors_feed_pacing) {
+  using boost::mysql::client_errc;
+  EXPECT_FALSE(sql::is_connect_error({}));
+  // Saturation, cancellation and shutdown say nothing about the server.
+  EXPECT_FALSE(sql::is_connect_error(client_errc::no_connection_available));
+  EXPECT_FALSE(sql::is_connect_error(client_errc::pool_not_running));
+  EXPECT_FALSE(sql::is_connect_error(boost::asio::error::operation_aborted));
+  EXPECT_TRUE(sql::is_connect_error(boost::asio::error::connection_refused));
+  EXPECT_TRUE(sql::is_connect_error(client_errc::auth_plugin_requires_ssl));
+}
+
+TEST(MysqlSslContextCacheTest, shares_one_ssl_ctx_per_fingerprint) {
+  namespace ssl = boost::asio::ssl;
+  int builds = 0;
+  auto build = [&builds] {
+    ++builds;
+    return ssl::context(ssl::context::tlsv12);
+  };
+  auto& cache = sql::SslContextCache::instance();
+  auto before = cache.size();
+  {
+    auto a = cache.get("ssl-cache-test:a", build);
+    auto b = cache.get("ssl-cache-test:a", build);
+    auto c = cache.get("ssl-cache-test:c", build);
+    EXPECT_EQ(builds, 2);
+    EXPECT_EQ(a, b);
+    EXPECT_NE(a->native_handle(), c->native_handle());
+    EXPECT_EQ(a->share().native_handle(), a->native_handle());
+    EXPECT_EQ(cache.size(), before + 2);
+  }
+  // Nobody uses them any more: evicted, and rebuilt on the next request.
+  EXPECT_EQ(cache.size(), before);
+  auto a = cache.get("ssl-cache-test:a", build);
+  EXPECT_EQ(builds, 3);
+}
+
+namespace {
+
+// Self-signed server context for in-memory handshakes.
+SSL_CTX* test_tls_server_ctx() {
+  SSL_CTX* ctx = SSL_CTX_new(TLS_server_method());
+  EVP_PKEY* key = EVP_RSA_gen(2048);
+  X509* cert = X509_new();
+  ASN1_INTEGER_set(X509_get_serialNumber(cert), 1);
+  X509_gmtime_adj(X509_getm_notBefore(cert), 0);
+  X509_gmtime_adj(X509_getm_notAfter(cert), 3600);
+  X509_set_pubkey(cert, key);
+  X509_NAME* name = X509_get_subject_name(cert);
+  X509_NAME_add_entry_by_txt(
+      name, "CN", MBSTRING_ASC,
+      reinterpret_cast<const unsigned char*>("localhost"), -1, -1, 0);
+  X509_set_issuer_name(cert, name);
+  X509_sign(cert, key, EVP_sha256());
+  SSL_CTX_use_certificate(ctx, cert);
+  SSL_CTX_use_PrivateKey(ctx, key);
+  X509_free(cert);
+  EVP_PKEY_free(key);
+  return ctx;
+}
+
+// One client handshake over a BIO pair, then a record from the server so
+// TLS 1.3 session tickets reach the client. Returns whether the session
+// was resumed.
+bool test_tls_connect(SSL_CTX* client_ctx, SSL_CTX* server_ctx) {
+  SSL* client = SSL_new(client_ctx);
+  SSL* server = SSL_new(server_ctx);
+  BIO* client_bio = nullptr;
+  BIO* server_bio = nullptr;
+  BIO_new_bio_pair(&client_bio, 0, &server_bio, 0);
+  SSL_set_bio(client, client_bio, client_bio);
+  SSL_set_bio(server, server_bio, server_bio);
+  SSL_set_connect_state(client);
+  SSL_set_accept_state(server);
+  for (int i = 0; i < 100; ++i) {
+    int c = SSL_do_handshake(client);
+    int s = SSL_do_handshake(server);
+    if (c == 1 && s == 1) break;
+  }
+  EXPECT_TRUE(SSL_is_init_finished(client) && SSL_is_init_finished(server));
+  SSL_write(server, "x", 1);
+  char buf[8];
+  EXPECT_EQ(SSL_read(client, buf, sizeof buf), 1);
+  bool reused = SSL_session_reused(client) == 1;
+  SSL_shutdown(client);
+  SSL_free(client);
+  SSL_free(server);
+  return reused;
+}
+
+}  // namespace
+
+TEST(MysqlSslContextCacheTest, resumes_the_stored_session) {
+  namespace ssl = boost::asio::ssl;
+  for (int version : {TLS1_2_VERSION, TLS1_3_VERSION}) {
+    SSL_CTX* server = test_tls_server_ctx();
+    SSL_CTX_set_max_proto_version(server, version);
+    auto resumed = sql::tls_metrics().resumed.load();
+    {
+      auto entry = sql::SslContextCache::instance().get(
+          "ssl-cache-test:resume",
+          [] { return ssl::context(ssl::context::tlsv12_client); });
+      auto ctx = entry->share();
+      EXPECT_FALSE(test_tls_connect(ctx.native_handle(), server));
+      EXPECT_TRUE(test_tls_connect(ctx.native_handle(), server));
+    }
+    EXPECT_EQ(sql::tls_metrics().resumed.load(), resumed + 1);
+    SSL_CTX_free(server);
+  }
+}
+
+TEST(MysqlStatementTest, session_state_classification) {
+  EXPECT_TRUE(sql::is_session_stateless("SELECT * FROM film WHERE id = 1"));
+  EXPECT_TRUE(sql::is_session_stateless(
+      "UPDATE t SET a = 2 WHERE a = 1; DELETE FROM t WHERE a = 3"));
+  EXPECT_TRUE(sql::is_session_stateless("SELECT @@GLOBAL.gtid_executed"));
+  EXPECT_TRUE(sql::is_session_stateless("SELECT LAST_INSERT_ID( )"));
+  // LAST_INSERT_ID() would leak to the connection's next borrower.
+  EXPECT_FALSE(sql::is_session_stateless("INSERT INTO t (a) VALUES (1)"));
+  EXPECT_FALSE(sql::is_session_stateless("REPLACE INTO t (a) VALUES (1)"));
+  EXPECT_FALSE(sql::is_session_stateless(
+      "UPDATE seq SET id = LAST_INSERT_ID(id + 1)"));
+  EXPECT_FALSE(sql::is_session_stateless("SET @x = 1"));
+  EXPECT_FALSE(sql::is_session_stateless("SELECT 1; SET NAMES utf8mb4"));
+  EXPECT_FALSE(sql::is_session_stateless("SELECT @rank := @rank + 1 FROM t"));
+  EXPECT_FALSE(sql::is_session_stateless("SELECT id INTO @id FROM t"));
+  EXPECT_FALSE(sql::is_session_stateless("CREATE TEMPORARY TABLE tmp (a INT)"));
+  EXPECT_FALSE(sql::is_session_stateless("START TRANSACTION"));
+  EXPECT_FALSE(sql::is_session_stateless("begin"));
+  EXPECT_FALSE(sql::is_session_stateless("LOCK TABLES t WRITE"));
+  EXPECT_FALSE(sql::is_session_stateless("PREPARE s FROM 'SELECT 1'"));
+  EXPECT_FALSE(sql::is_session_stateless("USE sakila"));
+  EXPECT_FALSE(sql::is_session_stateless("SELECT GET_LOCK('job', 0)"));
+  EXPECT_FALSE(sql::is_session_stateless("CALL refresh_stats()"));
+  EXPECT_FALSE(sql::is_session_stateless(""));
+}
+
+TEST(MysqlStatementTest, max_execution_time_hint) {
+  EXPECT_EQ(sql::with_max_execution_time("SELECT * FROM film", 250),
+            "SELECT /*+ MAX_EXECUTION_TIME(250) */ * FROM film");
+  EXPECT_EQ(sql::with_max_execution_time("SELECT /*+ BKA(t) */ a FROM t", 9),
+            "SELECT /*+ MAX_EXECUTION_TIME(9) BKA(t) */ a FROM t");
+  EXPECT_EQ(sql::with_max_execution_time("UPDATE t SET a = 1", 250),
+            "UPDATE t SET a = 1");
+  EXPECT_EQ(sql::with_max_execution_time("SELECT 1; SELECT 2", 250),
+            "SELECT 1; SELECT 2");
+}
+
+TEST(MysqlCancelTokenTest, handlers_run_once_and_late_subscribers_fire) {
+  auto token = sql::CancelToken::make();
+  int fired = 0;
+  auto id = token->subscribe([&] { ++fired; });
+  auto dropped = token->subscribe([&] { fired += 100; });
+  token->unsubscribe(dropped);
+  EXPECT_EQ(token->subscribers(), 1u);
+  EXPECT_FALSE(token->cancelled());
+
+  EXPECT_TRUE(token->cancel());
+  EXPECT_FALSE(token->cancel());
+  EXPECT_TRUE(token->cancelled());
+  EXPECT_EQ(fired, 1);
+  EXPECT_EQ(token->subscribers(), 0u);
+  token->unsubscribe(id);  // harmless after cancel
+
+  EXPECT_EQ(token->subscribe([&] { ++fired; }), 0u);
+  EXPECT_EQ(fired, 2);
+}
+
+TEST(MysqlLeaseRegistryTest, warns_once_and_offers_old_leases_for_reclaim) {
+  using Clock = std::chrono::steady_clock;
+  using std::chrono::milliseconds;
+  sql::LeaseRegistry<int> leases;
+  auto t0 = Clock::now();
+  auto old_lease = leases.open("handler.cpp:42", 7, t0);
+  auto young = leases.open("", 8, t0 + milliseconds(900));
+  EXPECT_EQ(leases.size(), 2u);
+
+  auto sweep = leases.sweep(milliseconds(500), milliseconds(0),
+                            t0 + milliseconds(1000));
+  ASSERT_EQ(sweep.warn.size(), 1u);
+  EXPECT_EQ(sweep.warn[0]->qid, 7u);
+  EXPECT_EQ(sweep.warn[0]->site, "handler.cpp:42");
+  EXPECT_TRUE(sweep.reclaim.empty());
+
+  // Already reported; only reclaim candidates show up again.
+  sweep = leases.sweep(milliseconds(500), milliseconds(2000),
+                       t0 + milliseconds(2500));
+  ASSERT_EQ(sweep.warn.size(), 1u);
+  EXPECT_EQ(sweep.warn[0].get(), young.get());
+  ASSERT_EQ(sweep.reclaim.size(), 1u);
+  EXPECT_EQ(sweep.reclaim[0].get(), old_lease.get());
+
+  leases.close(old_lease->id);
+  leases.close(young->id);
+  EXPECT_EQ(leases.size(), 0u);
+}
+
+TEST(MysqlPoolRegistryTest, creates_each_named_pool_once_on_first_use) {
+  struct Named {
+    std::string name;
+    int port;
+  };
+  sql::PoolRegistry<Named, Named> registry(
+      std::vector<Named>{{"billing", 3306}, {"analytics", 3307}});
+  int made = 0;
+  auto make = [&made](const Named& config) {
+    ++made;
+    return std::make_unique<Named>(config);
+  };
+
+  EXPECT_TRUE(registry.contains("billing"));
+  EXPECT_FALSE(registry.contains("missing"));
+  EXPECT_EQ(registry.find("missing", make), nullptr);
+  EXPECT_EQ(registry.created(), 0u);
+
+  auto* billing = registry.find("billing", make);
+  ASSERT_NE(billing, nullptr);
+  EXPECT_EQ(billing->port, 3306);
+  EXPECT_EQ(registry.find("billing", make), billing);
+  EXPECT_EQ(made, 1);
+  EXPECT_EQ(registry.created(), 1u);
+
+  std::vector<std::string> visited;
+  registry.for_each([&](Named& p) { visited.push_back(p.name); });
+  EXPECT_EQ(visited, std::vector<std::string>{"billing"});
+  EXPECT_EQ(registry.names(),
+            (std::vector<std::string>{"billing", "analytics"}));
+}
+
+TEST(MysqlRetryTest, classifies_failures_and_backs_off_within_bounds) {
+  using sql::RetryClass;
+  using std::chrono::milliseconds;
+  EXPECT_EQ(sql::classify_server_errno(1213), RetryClass::RolledBack);
+  EXPECT_EQ(sql::classify_server_errno(1205), RetryClass::RolledBack);
+  EXPECT_EQ(sql::classify_server_errno(1927), RetryClass::Ambiguous);
+  EXPECT_EQ(sql::classify_server_errno(1062), RetryClass::Permanent);
+  // CR_SERVER_LOST is a client code, not a server verdict.
+  EXPECT_EQ(sql::classify_server_errno(2013), RetryClass::Permanent);
+
+  // A connection lost mid-statement is detected on the client side.
+  using boost::mysql::client_errc;
+  EXPECT_EQ(sql::classify_failure(client_errc::incomplete_message),
+            RetryClass::Ambiguous);
+  EXPECT_EQ(sql::classify_failure(client_errc::sequence_number_mismatch),
+            RetryClass::Ambiguous);
+  EXPECT_EQ(sql::classify_failure(client_errc::pool_not_running),
+            RetryClass::NotExecuted);
+  EXPECT_EQ(sql::classify_failure(client_errc::wrong_num_params),
+            RetryClass::Permanent);
+  EXPECT_EQ(sql::classify_failure(boost::asio::error::connection_reset),
+            RetryClass::Ambiguous);
+  EXPECT_EQ(sql::classify_failure(boost::system::error_code(
+                1213, boost::mysql::get_common_server_category())),
+            RetryClass::RolledBack);
+
+  // A rolled-back single statement is safe to repeat; a multi-statement
+  // text or a broken connection needs the idempotency promise.
+  EXPECT_TRUE(sql::may_retry(RetryClass::NotExecuted, false, false));
+  EXPECT_TRUE(sql::may_retry(RetryClass::RolledBack, false, true));
+  EXPECT_FALSE(sql::may_retry(RetryClass::RolledBack, false, false));
+  EXPECT_FALSE(sql::may_retry(RetryClass::Ambiguous, false, true));
+  EXPECT_TRUE(sql::may_retry(RetryClass::Ambiguous, true, false));
+  EXPECT_FALSE(sql::may_retry(RetryClass::Permanent, true, true));
+  EXPECT_EQ(sql::statement_count("UPDATE t SET a = 1; SELECT ';'"), 2u);
+
+  sql::RetryPolicy policy;
+  policy.base_delay = milliseconds(20);
+  policy.max_delay = milliseconds(100);
+  EXPECT_EQ(policy.backoff(1, 0.0), milliseconds(10));
+  EXPECT_EQ(policy.backoff(2, 0.0), milliseconds(20));
+  EXPECT_EQ(policy.backoff(3, 0.99), milliseconds(79));
+  EXPECT_EQ(policy.backoff(10, 0.0), milliseconds(50));
+  EXPECT_LE(policy.backoff(10, 0.999), milliseconds(100));
+}
+
+TEST(MysqlTenantLimiterTest, enforces_rate_and_in_flight_per_tenant) {
+  using std::chrono::milliseconds;
+  sql::TenantLimits acme;
+  acme.qps = 10;
+  acme.burst = 2;
+  sql::TenantLimits others;
+  others.max_in_flight = 1;
+  sql::TenantLimiter limiter({{"acme", acme}, {"*", others}});
+  ASSERT_TRUE(limiter.enabled());
+  EXPECT_EQ(limiter.find("acme"), nullptr);
+
+  auto& a = limiter.state("acme");
+  EXPECT_EQ(&limiter.state("acme"), &a);
+  auto t0 = std::chrono::steady_clock::now();
+  EXPECT_EQ(a.try_acquire(t0).result, sql::TenantAdmission::Admitted);
+  EXPECT_EQ(a.try_acquire(t0).result, sql::TenantAdmission::Admitted);
+  auto limited = a.try_acquire(t0);
+  EXPECT_EQ(limited.result, sql::TenantAdmission::RateLimited);
+  EXPECT_EQ(limited.retry_after, milliseconds(100));
+  EXPECT_EQ(a.try_acquire(t0 + milliseconds(100)).result,
+            sql::TenantAdmission::Admitted);
+  EXPECT_EQ(a.in_flight(), 3u);
+  EXPECT_EQ(a.metrics().admitted.load(), 3u);
+
+  // Unlisted tenants get the "*" limits, each with its own quota.
+  auto& b = limiter.state("beta");
+  EXPECT_EQ(b.try_acquire().result, sql::TenantAdmission::Admitted);
+  EXPECT_EQ(b.try_acquire().result, sql::TenantAdmission::InFlightLimited);
+  EXPECT_EQ(limiter.state("gamma").try_acquire().result,
+            sql::TenantAdmission::Admitted);
+  b.release();
+  EXPECT_EQ(b.try_acquire().result, sql::TenantAdmission::Admitted);
+  EXPECT_EQ(limiter.find("beta"), &b);
+}
+
+TEST(MysqlIoLagTrackerTest, names_the_slowest_handler_of_a_lagging_window) {
+  using std::chrono::milliseconds;
+  sql::IoLagTracker tracker(milliseconds(50));
+  tracker.handler_done("fast.cpp:1", milliseconds(2));
+  tracker.handler_done("report.cpp:88", milliseconds(70));
+  tracker.handler_done("fast.cpp:2", milliseconds(5));
+  {
+    sql::IoLagTracker::Scope scope(nullptr, "untracked");
+  }
+
+  auto sample = tracker.record(milliseconds(80));
+  EXPECT_TRUE(sample.over);
+  EXPECT_EQ(sample.culprit, "report.cpp:88");
+  EXPECT_EQ(sample.culprit_took, milliseconds(70));
+  EXPECT_EQ(tracker.lagged(), 1u);
+
+  // A new window starts after every probe.
+  tracker.handler_done("fast.cpp:1", milliseconds(1));
+  sample = tracker.record(milliseconds(3));
+  EXPECT_FALSE(sample.over);
+  EXPECT_TRUE(sample.culprit.empty());
+  sample = tracker.record(milliseconds(60));
+  EXPECT_TRUE(sample.over);
+  EXPECT_TRUE(sample.culprit.empty());
+  EXPECT_EQ(tracker.max_lag(), milliseconds(80));
+  EXPECT_EQ(tracker.histogram().count(), 3u);
+}
+
+TEST(MysqlScatterTest, compares_fields_like_order_by) {
+  using mysql::field_view;
+  EXPECT_LT(monad::compare_fields(field_view(), field_view(int64_t{-5})), 0);
+  EXPECT_EQ(monad::compare_fields(field_view(), field_view()), 0);
+  EXPECT_GT(monad::compare_fields(field_view(int64_t{10}),
+                                  field_view(int64_t{9})),
+            0);
+  EXPECT_LT(monad::compare_fields(field_view(int64_t{2}), field_view(2.5)),
+            0);
+
+  // DECIMAL arrives as text: numeric order only with the column type.
+  field_view big(std::string_view("10.5"));
+  field_view small(std::string_view("9.1"));
+  EXPECT_LT(monad::compare_fields(big, small), 0);
+  EXPECT_GT(monad::compare_fields(big, small, mysql::column_type::decimal),
+            0);
+  EXPECT_EQ(monad::compare_decimal("-0.00", "0"), 0);
+  EXPECT_EQ(monad::compare_decimal("007.50", "7.5"), 0);
+  EXPECT_LT(monad::compare_decimal("-12.5", "-3"), 0);
+  EXPECT_LT(monad::compare_decimal("0.5", "0.51"), 0);
+  EXPECT_GT(monad::compare_decimal("100", "99.999"), 0);
+}
+
+TEST(MysqlScatterTest, merges_runs_with_ties_empty_runs_and_nulls) {
+  using mysql::field_view;
+  using Row = std::pair<field_view, char>;
+  auto less = [](const Row& a, const Row& b) {
+    return monad::compare_fields(a.first, b.first) < 0;
+  };
+  std::vector<std::vector<Row>> runs{
+      {{field_view(), 'a'}, {field_view(int64_t{2}), 'a'}},
+      {},
+      {{field_view(int64_t{1}), 'c'}, {field_view(int64_t{2}), 'c'}},
+      {{field_view(), 'd'}, {field_view(int64_t{3}), 'd'}},
+  };
+  std::string order;
+  auto n = monad::merge_runs(runs, less, 10,
+                             [&](const Row& r) { order += r.second; });
+  // NULLs first; equal keys keep run order.
+  EXPECT_EQ(n, 6u);
+  EXPECT_EQ(order, "adcacd");
+
+  order.clear();
+  EXPECT_EQ(monad::merge_runs(runs, less, 3,
+                              [&](const Row& r) { order += r.second; }),
+            3u);
+  EXPECT_EQ(order, "adc");
+  EXPECT_EQ(monad::merge_runs(std::vector<std::vector<Row>>(2), less, 5,
+                              [](const Row&) {}),
+            0u);
+}
+
+TEST(MysqlScatterTest, adds_count_sum_and_decimal_partials) {
+  using mysql::field_view;
+  int64_t total = 0;
+  EXPECT_TRUE(monad::add_partial(total, field_view(int64_t{40})).is_ok());
+  // SUM() of an integer column is DECIMAL; NULL is an empty shard.
+  EXPECT_TRUE(
+      monad::add_partial(total, field_view(std::string_view("-15"))).is_ok());
+  EXPECT_TRUE(
+      monad::add_partial(total, field_view(std::string_view("5.000")))
+          .is_ok());
+  EXPECT_TRUE(monad::add_partial(total, field_view()).is_ok());
+  EXPECT_EQ(total, 30);
+  EXPECT_TRUE(
+      monad::add_partial(total, field_view(std::string_view("0.5"))).is_err());
+  EXPECT_TRUE(monad::add_partial(
+                  total, field_view(std::string_view("99999999999999999999")))
+                  .is_err());
+  int64_t near_max = std::numeric_limits<int64_t>::max() - 1;
+  EXPECT_TRUE(monad::add_partial(near_max, field_view(int64_t{2})).is_err());
+  EXPECT_EQ(total, 30);
+
+  double sum = 0;
+  EXPECT_TRUE(
+      monad::add_partial(sum, field_view(std::string_view("2.25"))).is_ok());
+  EXPECT_TRUE(monad::add_partial(sum, field_view(0.75)).is_ok());
+  EXPECT_TRUE(monad::add_partial(sum, field_view(int64_t{1})).is_ok());
+  EXPECT_DOUBLE_EQ(sum, 4.0);
+  EXPECT_TRUE(
+      monad::add_partial(sum, field_view(std::string_view("n/a"))).is_err());
+}
+
+TEST(MysqlHedgeTest, delay_follows_replica_p95_and_budget_caps_hedges) {
+  using std::chrono::microseconds;
+  using std::chrono::milliseconds;
+  sql::LatencyHistogram latency;
+  for (uint64_t i = 0; i + 1 < sql::kHedgeMinSamples; ++i) {
+    latency.record(milliseconds(3));
+  }
+  // Too few samples: no hedging yet.
+  EXPECT_FALSE(sql::hedge_delay(latency, milliseconds(2)).has_value());
+  latency.record(milliseconds(3));
+  // 3ms lands in the [2048us, 4096us) bucket.
+  EXPECT_EQ(sql::hedge_delay(latency, milliseconds(2)),
+            std::chrono::steady_clock::duration(microseconds(4096)));
+  EXPECT_EQ(sql::hedge_delay(latency, milliseconds(10)),
+            std::chrono::steady_clock::duration(milliseconds(10)));
+
+  EXPECT_EQ(latency.quantile(0.5), microseconds(4096));
+  for (int i = 0; i < 64 * 19; ++i) latency.record(microseconds(100));
+  EXPECT_EQ(latency.quantile(0.5), microseconds(128));
+  EXPECT_EQ(latency.quantile(0.99), microseconds(4096));
+
+  // 5% budget: the first hedge needs 20 replica reads.
+  EXPECT_FALSE(sql::hedge_within_budget(19, 0, 5));
+  EXPECT_TRUE(sql::hedge_within_budget(20, 0, 5));
+  EXPECT_FALSE(sql::hedge_within_budget(20, 1, 5));
+  EXPECT_TRUE(sql::hedge_within_budget(40, 1, 5));
+  EXPECT_FALSE(sql::hedge_within_budget(1000, 0, 0));
+}
+
+// Smallest JSON accepted as a MysqlConfig.
+static json::object minimal_mysql_config_json() {
+  return json::object{{"host", "primary"},      {"port", 3306},
+                      {"username", "app"},      {"password", "secret"},
+                      {"database", "sakila"},   {"ca_str", ""},
+                      {"cert_str", ""},         {"cert_key_str", ""},
+                      {"ssl", 0},               {"multi_queries", true},
+                      {"unix_socket", ""},      {"username_socket", ""},
+                      {"password_socket", ""},  {"thread_safe", true}};
+}
+
+TEST(MysqlConfigTest, partitions_inherit_the_server_and_override_sizing) {
+  auto jo = minimal_mysql_config_json();
+  jo["max_size"] = 32;
+  jo["acquire_timeout_ms"] = 1000;
+  jo["partitions"] = json::object{
+      {"report", json::object{{"max_size", 4}, {"acquire_timeout_ms", 30000}}},
+      {"batch", json::object{{"max_size", 8}}}};
+  auto config = json::value_to<sql::MysqlConfig>(json::value(jo));
+
+  ASSERT_EQ(config.partitions.size(), 2u);
+  const sql::MysqlConfig* report = nullptr;
+  const sql::MysqlConfig* batch = nullptr;
+  for (const auto& p : config.partitions) {
+    (p.name == "report" ? report : batch) = &p;
+  }
+  ASSERT_NE(report, nullptr);
+  ASSERT_NE(batch, nullptr);
+  EXPECT_EQ(batch->name, "batch");
+  // Same server and credentials as the main pool, own sizing.
+  EXPECT_EQ(report->host, "primary");
+  EXPECT_EQ(report->username, "app");
+  EXPECT_EQ(report->max_size, 4u);
+  EXPECT_EQ(report->acquire_timeout_ms, 30000u);
+  EXPECT_EQ(batch->max_size, 8u);
+  EXPECT_EQ(batch->acquire_timeout_ms, 1000u);
+  EXPECT_TRUE(report->partitions.empty());
+  EXPECT_TRUE(config.name.empty());
+  EXPECT_EQ(config.max_size, 32u);
+}
+
+TEST_F(MonadMysqlTest, warm_up_opens_connections_and_returns_them) {
+  std::optional<monad::MyResult<std::size_t>> warmed;
+  pool().warm_up(2, std::chrono::seconds(5)).run([&](auto r) {
+    warmed = std::move(r);
+    this->notifyCompletion();
+  });
+  this->waitForCompletion();
+  ASSERT_TRUE(warmed && warmed->is_ok());
+  EXPECT_EQ(warmed->value(), 2u);
+  // Every attempt held a gate permit and gave it back.
+  EXPECT_EQ(pool().gate().in_use(), 0u);
+
+  pool().warm_up(0, std::chrono::seconds(5)).run([&](auto r) {
+    warmed = std::move(r);
+    this->notifyCompletion();
+  });
+  this->waitForCompletion();
+  ASSERT_TRUE(warmed->is_ok());
+  EXPECT_EQ(warmed->value(), 0u);
+
+  // The warmed connections went back to the pool and serve queries.
+  session_->run_query("SELECT 1").run([&](auto r) {
+    EXPECT_TRUE(r.is_ok());
+    EXPECT_FALSE(r.value().has_error());
+    this->notifyCompletion();
+  });
+  this->waitForCompletion();
+}
+
+TEST_F(MonadMysqlTest, exec_timeout_aborts_a_long_statement) {
+  using namespace std::chrono_literals;
+  monad::QueryOptions opts;
+  opts.exec_timeout = 200ms;
+  std::optional<monad::MyResult<monad::MysqlSessionState>> result;
+  auto started = std::chrono::steady_clock::now();
+  std::chrono::steady_clock::duration took{};
+  session_->run_query("SELECT SLEEP(5)", opts).run([&](auto r) {
+    took = std::chrono::steady_clock::now() - started;
+    result = std::move(r);
+    this->notifyCompletion();
+  });
+  this->waitForCompletion();
+  ASSERT_TRUE(result && result->is_err());
+  EXPECT_EQ(result->error().code, db_errors::SQL_EXEC::QUERY_TIMEOUT);
+  EXPECT_LT(took, 1s);
+
+  // The pool is still usable afterwards.
+  session_->run_query("SELECT 1").run([&](auto r) {
+    EXPECT_TRUE(r.is_ok());
+    EXPECT_FALSE(r.value().has_error());
+    this->notifyCompletion();
+  });
+  this->waitForCompletion();
+}
+
+TEST_F(MonadMysqlTest, spent_budget_fails_the_next_stage_without_acquiring) {
+  using namespace std::chrono_literals;
+  monad::QueryOptions opts;
+  opts.deadline = std::chrono::steady_clock::now() + 100ms;
+  std::optional<monad::MyResult<monad::MysqlSessionState>> result;
+  uint64_t acquired = 0;
+  std::chrono::steady_clock::time_point stage_started;
+  std::chrono::steady_clock::duration took{};
+  session_->run_query("SELECT SLEEP(0.3)")
+      .then([&, self = session_](monad::MysqlSessionState) {
+        acquired = pool().metrics().acquire_wait.count();
+        stage_started = std::chrono::steady_clock::now();
+        return self->run_query("SELECT 1", opts);
+      })
+      .run([&](auto r) {
+        took = std::chrono::steady_clock::now() - stage_started;
+        result = std::move(r);
+        this->notifyCompletion();
+      });
+  this->waitForCompletion();
+  ASSERT_TRUE(result && result->is_err());
+  EXPECT_EQ(result->error().code, db_errors::SQL_EXEC::DEADLINE_EXCEEDED);
+  EXPECT_LT(took, 50ms);
+  EXPECT_EQ(pool().metrics().acquire_wait.count(), acquired);
+}
+
+TEST_F(MonadMysqlTest, budget_shortens_the_acquire_timeout) {
+  using namespace std::chrono_literals;
+  auto own = make_pool();
+  own->set_capacity(1);
+  auto session = make_session(*own);
+
+  // Hold the only permit.
+  std::promise<void> slept;
+  session->run_query("SELECT SLEEP(1)").run([&](auto) { slept.set_value(); });
+  for (int i = 0; i < 200 && own->gate().in_use() == 0; ++i) {
+    std::this_thread::sleep_for(5ms);
+  }
+  ASSERT_EQ(own->gate().in_use(), 1u);
+
+  monad::QueryOptions opts;
+  opts.timeout = 5s;
+  opts.deadline = std::chrono::steady_clock::now() + 300ms;
+  std::optional<monad::MyResult<monad::MysqlSessionState>> result;
+  auto started = std::chrono::steady_clock::now();
+  std::chrono::steady_clock::duration took{};
+  session->run_query("SELECT 1", opts).run([&](auto r) {
+    took = std::chrono::steady_clock::now() - started;
+    result = std::move(r);
+    this->notifyCompletion();
+  });
+  this->waitForCompletion();
+  ASSERT_TRUE(result);
+  EXPECT_TRUE(result->is_err() || result->value().has_error());
+  // Gave up with the budget, long before the acquire timeout.
+  EXPECT_GE(took, 250ms);
+  EXPECT_LT(took, 900ms);
+  slept.get_future().wait();
+}
+
+TEST_F(MonadMysqlTest, statement_outliving_the_budget_is_deadline_exceeded) {
+  using namespace std::chrono_literals;
+  monad::QueryOptions opts;
+  opts.exec_timeout = 5s;
+  // Cut short by the MAX_EXECUTION_TIME hint (SELECT) and by KILL QUERY
+  // (anything else).
+  for (std::string sql : {"SELECT SLEEP(2)", "DO SLEEP(2)"}) {
+    opts.deadline = std::chrono::steady_clock::now() + 200ms;
+    std::optional<monad::MyResult<monad::MysqlSessionState>> result;
+    auto started = std::chrono::steady_clock::now();
+    std::chrono::steady_clock::duration took{};
+    session_->run_query(sql, opts).run([&](auto r) {
+      took = std::chrono::steady_clock::now() - started;
+      result = std::move(r);
+      this->notifyCompletion();
+    });
+    this->waitForCompletion();
+    ASSERT_TRUE(result && result->is_err()) << sql;
+    EXPECT_EQ(result->error().code, db_errors::SQL_EXEC::DEADLINE_EXCEEDED)
+        << sql;
+    EXPECT_LT(took, 1s) << sql;
+  }
+}
+
+TEST_F(MonadMysqlTest, drain_lets_running_work_finish_then_rejects_new_work) {
+  auto own = make_pool();
+  auto session = make_session(*own);
+
+  std::promise<bool> slept;
+  session->run_query("SELECT SLEEP(0.3)").run([&](auto r) {
+    slept.set_value(r.is_ok() && !r.value().has_error());
+  });
+  // Drain once the statement is executing.
+  for (int i = 0; i < 200 && own->running_statements() == 0; ++i) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(5));
+  }
+  std::optional<monad::MyResult<sql::DrainReport>> report;
+  own->drain(std::chrono::seconds(5)).run([&](auto r) {
+    report = std::move(r);
+    this->notifyCompletion();
+  });
+  this->waitForCompletion();
+  EXPECT_TRUE(slept.get_future().get());
+  ASSERT_TRUE(report && report->is_ok());
+  EXPECT_TRUE(report->value().clean);
+  EXPECT_EQ(report->value().killed, 0u);
+  EXPECT_EQ(report->value().abandoned, 0u);
+
+  session->run_query("SELECT 1").run([&](auto r) {
+    EXPECT_TRUE(r.is_err());
+    if (r.is_err()) EXPECT_EQ(r.error().code, db_errors::POOL::DRAINING);
+    this->notifyCompletion();
+  });
+  this->waitForCompletion();
+}
+
+TEST(MysqlConfigTest, equality_sees_sizing_nested_and_tenant_fields) {
+  auto base = json::value_to<sql::MysqlConfig>(
+      json::value(minimal_mysql_config_json()));
+  EXPECT_TRUE(base == sql::MysqlConfig(base));
+
+  auto resized = base;
+  resized.max_size += 1;
+  EXPECT_FALSE(resized == base);
+  auto pinged = base;
+  pinged.ping_interval = 60;
+  EXPECT_FALSE(pinged == base);
+  auto partitioned = base;
+  partitioned.partitions.push_back(base.overlay(json::object{}));
+  EXPECT_FALSE(partitioned == base);
+  auto limited = base;
+  limited.tenant_limits["acme"].qps = 50;
+  EXPECT_FALSE(limited == base);
+
+  // Sizing survives serialization, so a written-back config keeps it.
+  auto round_trip = json::value_to<sql::MysqlConfig>(json::value_from(resized));
+  EXPECT_EQ(round_trip.max_size, resized.max_size);
+  EXPECT_EQ(round_trip.initial_size, resized.initial_size);
+  EXPECT_EQ(round_trip.ping_interval, resized.ping_interval);
+}
+
+TEST_F(MonadMysqlTest, reload_switches_pools_and_prunes_retired_ones) {
+  auto own = make_pool();
+  auto reload = [&](const sql::MysqlConfig& next) {
+    std::optional<monad::MyResult<bool>> switched;
+    own->reload(next).run([&](auto r) {
+      switched = std::move(r);
+      this->notifyCompletion();
+    });
+    this->waitForCompletion();
+    return switched && switched->is_ok() && switched->value();
+  };
+  auto config = own->config();
+  EXPECT_FALSE(reload(config));
+  EXPECT_EQ(&own->current(), own.get());
+  EXPECT_EQ(own->generation_count(), 0u);
+
+  // A max_size-only change is a new generation.
+  config.max_size += 1;
+  EXPECT_TRUE(reload(config));
+  auto* first = &own->current();
+  ASSERT_NE(first, own.get());
+  EXPECT_EQ(first->config().max_size, config.max_size);
+  EXPECT_EQ(own->generation_count(), 1u);
+
+  auto session = make_session(*own);
+  session->run_query("SELECT 1").run([&](auto r) {
+    EXPECT_TRUE(r.is_ok());
+    EXPECT_FALSE(r.value().has_error());
+    this->notifyCompletion();
+  });
+  this->waitForCompletion();
+
+  // The first generation drains behind the second but is kept while
+  // pinned; the second keeps its tenant limiter (tenant_limits unchanged).
+  auto pinned = own->pin_current();
+  EXPECT_EQ(pinned.get(), first);
+  config.max_size += 1;
+  EXPECT_TRUE(reload(config));
+  auto* second = &own->current();
+  EXPECT_NE(second, first);
+  EXPECT_EQ(&second->tenants(), &pinned->tenants());
+  for (int i = 0; i < 300 && !pinned->stopped(); ++i) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  }
+  EXPECT_TRUE(pinned->stopped());
+  std::this_thread::sleep_for(std::chrono::milliseconds(200));
+  EXPECT_EQ(own->generation_count(), 2u);
+
+  // Unpinned, it is pruned.
+  pinned.reset();
+  for (int i = 0; i < 300 && own->generation_count() > 1; ++i) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  }
+  EXPECT_EQ(own->generation_count(), 1u);
+
+  own->stop();
+  EXPECT_TRUE(own->stopped());
+  EXPECT_TRUE(second->stopped());
+}
+
+TEST_F(MonadMysqlTest, results_are_delivered_on_the_completion_executor) {
+  boost::asio::io_context workers;
+  auto work = boost::asio::make_work_guard(workers);
+  std::thread worker([&workers] { workers.run(); });
+
+  monad::QueryOptions opts;
+  opts.completion_executor = workers.get_executor();
+  std::thread::id delivered_on;
+  std::thread::id continued_on;
+  session_->run_query("SELECT 1", opts)
+      .then([&](auto state) {
+        continued_on = std::this_thread::get_id();
+        return monad::IO<monad::MysqlSessionState>::pure(std::move(state));
+      })
+      .run([&](auto r) {
+        EXPECT_TRUE(r.is_ok());
+        delivered_on = std::this_thread::get_id();
+        this->notifyCompletion();
+      });
+  this->waitForCompletion();
+  EXPECT_EQ(delivered_on, worker.get_id());
+  EXPECT_EQ(continued_on, worker.get_id());
+
+  // A statement the server rejects is delivered there too.
+  session_->run_query("SELECT x* FROM cjj365_users", opts).run([&](auto r) {
+    EXPECT_TRUE(r.is_ok() && r.value().has_error());
+    delivered_on = std::this_thread::get_id();
+    this->notifyCompletion();
+  });
+  this->waitForCompletion();
+  EXPECT_EQ(delivered_on, worker.get_id());
+
+  work.reset();
+  worker.join();
+}
+
+TEST(MysqlCoroTest, async_run_resumes_on_the_awaiting_executor) {
+  using monad::IO;
+  boost::asio::io_context other;
+  auto work = boost::asio::make_work_guard(other);
+  std::thread other_thread([&other] { other.run(); });
+
+  boost::asio::io_context ctx;
+  auto awaiting_thread = std::this_thread::get_id();
+  bool finished = false;
+  boost::asio::co_spawn(
+      ctx,
+      [&]() -> boost::asio::awaitable<void> {
+        auto ok = co_await monad::async_run(IO<int>::pure(7));
+        EXPECT_TRUE(ok.is_ok() && ok.value() == 7);
+
+        auto failing = IO<int>::fail(
+            monad::Error{db_errors::SQL_EXEC::SQL_FAILED, "boom"});
+        auto failed = co_await monad::async_run(std::move(failing));
+        EXPECT_TRUE(failed.is_err() &&
+                    failed.error().code == db_errors::SQL_EXEC::SQL_FAILED);
+
+        // Completed on another thread, resumed on this coroutine's.
+        auto hopped = co_await monad::async_run(IO<int>([&other](auto cb) {
+          boost::asio::post(other, [cb]() mutable {
+            cb(IO<int>::IOResult::Ok(9));
+          });
+        }));
+        EXPECT_TRUE(hopped.is_ok() && hopped.value() == 9);
+        EXPECT_EQ(std::this_thread::get_id(), awaiting_thread);
+        finished = true;
+      },
+      boost::asio::detached);
+  ctx.run();
+  EXPECT_TRUE(finished);
+
+  work.reset();
+  other_thread.join();
+}
+
+TEST_F(MonadMysqlTest, co_transaction_commits_on_ok_and_rolls_back_on_err) {
+  namespace asio = boost::asio;
+  using monad::CoTransaction;
+  using monad::MyVoidResult;
+  auto count = [](monad::MonadicMysqlSession& s,
+                  std::string name) -> asio::awaitable<int64_t> {
+    auto r = co_await monad::co_run_prepared(
+        s, {}, "SELECT COUNT(*) FROM country WHERE country = {}", name);
+    if (r.is_err()) co_return -1;
+    auto n = r.value().expect_count("country count", 0);
+    co_return n.is_ok() ? n.value() : -1;
+  };
+
+  asio::io_context ctx;
+  bool finished = false;
+  asio::co_spawn(
+      ctx,
+      [&]() -> asio::awaitable<void> {
+        auto committed = co_await monad::co_transaction(
+            session_, [](CoTransaction& tx) -> asio::awaitable<MyVoidResult> {
+              co_return co_await tx.execute(
+                  "INSERT INTO country (country, last_update) "
+                  "VALUES ('Coro Commit', NOW())");
+            });
+        EXPECT_TRUE(committed.is_ok());
+        auto kept = co_await count(*session_, "Coro Commit");
+        EXPECT_EQ(kept, 1);
+
+        auto rolled_back = co_await monad::co_transaction(
+            session_, [](CoTransaction& tx) -> asio::awaitable<MyVoidResult> {
+              auto r = co_await tx.execute(
+                  "INSERT INTO country (country, last_update) "
+                  "VALUES ('Coro Rollback', NOW())");
+              if (r.is_err()) co_return r;
+              co_return MyVoidResult::Err(
+                  monad::Error{db_errors::SQL_EXEC::SQL_FAILED, "abort"});
+            });
+        EXPECT_TRUE(rolled_back.is_err());
+        auto undone = co_await count(*session_, "Coro Rollback");
+        EXPECT_EQ(undone, 0);
+
+        co_await monad::co_run_query(
+            *session_, "DELETE FROM country WHERE country = 'Coro Commit'");
+        finished = true;
+      },
+      asio::detached);
+  ctx.run();
+  EXPECT_TRUE(finished);
+}